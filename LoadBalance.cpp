@@ -28,23 +28,122 @@
 * Balance computation load across MPI ranks
 **/
 
-#include <iostream>
-#include <mpi.h>
-#include <cmath>
-#include <vector>
+#include <ctime>
+#include <fstream>
+#include <sstream>
 
-#define MASTER 0
+#include "Modes.h"
 
-template< typename T >
-T randomizer(const T& low, const T& high)
+//! Depth of --config files including each other
+const int MAX_CONFIGS = 16;
+
+//! Read a config file into command-line arguments: one option per line, with or without the leading dashes,
+//! followed by its value if it takes one. Everything after a # is a comment. --config lines are expanded in
+//! place, at most MAX_CONFIGS files deep; on failure, error says which file could not be read.
+bool readConfig(const std::string& path, std::vector<std::string>& tokens, std::string& error, const int depth = 1)
+{
+	if (depth > MAX_CONFIGS)
+	{
+		error = "Cannot read config " + path + " (nested too deeply)";
+		return false;
+	}
+
+	std::ifstream file(path.c_str());
+	if (!file)
+	{
+		error = "Cannot read config " + path;
+		return false;
+	}
+
+	std::vector<std::string> args;
+	std::string line;
+	while (std::getline(file, line))
+	{
+		std::istringstream words(line.substr(0, line.find('#')));
+		std::string word;
+		for (bool first = true; words >> word; first = false)
+			args.push_back((first && (word.compare(0, 2, "--") != 0)) ? "--" + word : word);
+	}
+
+	for (size_t i = 0; i < args.size(); i++)
+	{
+		if ((args[i] == "--config") && (i + 1 < args.size()))
+		{
+			if (!readConfig(args[++i], tokens, error, depth + 1))
+				return false;
+		}
+		else
+			tokens.push_back(args[i]);
+	}
+
+	return true;
+}
+
+//! Report a startup error on the master and shut MPI down; returns the exit status of main
+int startupError(const int worldRank, const std::string& message)
 {
-	return (static_cast<T>(rand()) / static_cast<T>(RAND_MAX / (high - low)) + low);
+	if (worldRank == MASTER)
+		std::cerr << message << std::endl;
+	MPI_Finalize();
+	return EXIT_FAILURE;
+}
+
+//! Check the options of one run against the rules of its mode; the master reports the first violation
+bool checkOptions(const Options& opts, const int worldSize, const int worldRank, const bool anyGpu)
+{
+	//! Narrow wire formats apply to the modes that move data with collectives; fixed16 covers the generated
+	//! angle range only
+	bool wireMode = (opts.mode == Mode::COLLECTIVE) || (opts.mode == Mode::DECENTRALIZED)
+					|| (opts.mode == Mode::STREAM);
+	bool fixedRange = (opts.input == MPI_FILE_NULL) && (opts.angleMin >= 0.0) && (opts.angleMax <= 360.0);
+
+	//! Results stay distributed only where they end up in contiguous ranges of the global order
+	bool keepMode = (opts.mode == Mode::COLLECTIVE) || (opts.mode == Mode::DECENTRALIZED)
+					|| (opts.mode == Mode::PIPELINE) || (opts.mode == Mode::HIERARCHICAL)
+					|| (opts.mode == Mode::DIFFUSION);
+
+	//! The steal mode packs the bounds of every rank's queue into the halves of one 64-bit word
+	std::vector<long long> counts(1, opts.countMax);
+	if ((opts.mode == Mode::STEAL) && (opts.input != MPI_FILE_NULL))
+		counts = balancedCounts(opts.inputSize, worldSize, masterReads(opts, worldSize));
+	else if ((opts.mode == Mode::STEAL) && (opts.scaling != Scaling::RANDOM))
+		counts = generatedCounts(opts, worldSize);
+
+	std::ostringstream error;
+	if (opts.countMin > opts.countMax)
+		error << "--count-min must not exceed --count-max";
+	else if (!(opts.angleMin <= opts.angleMax))
+		error << "--angle-min must not exceed --angle-max";
+	else if (anyGpu && ((opts.mode != Mode::DECENTRALIZED) || (opts.wire != Wire::DOUBLE)))
+		error << "--backend gpu needs the decentralized mode and the double wire format";
+	else if ((opts.mode == Mode::STREAM) && (opts.input == MPI_FILE_NULL))
+		error << "The stream mode needs an --input file";
+	else if ((opts.wire != Wire::DOUBLE) && (!wireMode || ((opts.wire == Wire::FIXED16) && !fixedRange)))
+		error << "--wire " << wireName(opts.wire) << " needs the collective, decentralized or stream mode"
+			  << ((opts.wire == Wire::FIXED16) ? " and generated angles in [0, 360]" : "");
+	else if (opts.keepResults && !keepMode)
+		error << "--keep-results needs the collective, decentralized, pipeline, hierarchical or diffusion mode";
+	else if (((opts.timeout > 0.0) || opts.speculate || !opts.checkpoint.empty()) && (opts.mode != Mode::DYNAMIC))
+		error << "--timeout, --speculate and --checkpoint need the dynamic mode";
+	else if (opts.dedupe && ((opts.mode != Mode::COLLECTIVE) || opts.keepResults))
+		error << "--dedupe needs the collective mode without --keep-results";
+	else if (opts.returnResults && (opts.mode != Mode::DECENTRALIZED))
+		error << "--return-results needs the decentralized mode";
+	else if ((opts.mode == Mode::STEAL) && (*std::max_element(counts.begin(), counts.end()) >= TAIL_BIAS))
+		error << "The steal mode supports at most " << TAIL_BIAS - 1 << " angles per rank";
+
+	if (error.str().empty())
+		return true;
+	if (worldRank == MASTER)
+		std::cerr << error.str() << " (strategy " << strategyName(opts) << ")" << std::endl;
+	return false;
 }
 
 int main(int argc, char ** argv)
 {
-	//! Initialize MPI
-	MPI_Init(&argc, &argv);
+	//! Initialize MPI; only the main thread makes MPI calls, compute threads never do
+	int provided;
+	MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
 
 	//! Number of ranks
 	int worldSize;
@@ -54,132 +153,370 @@ int main(int argc, char ** argv)
 	int worldRank;
 	MPI_Comm_rank(MPI_COMM_WORLD, &worldRank);
 
-	int numAngles, balancedSize;
-	std::vector<double> masterVec, slaveVec, tmpVec;
-
-	if (worldRank == MASTER)
+	//! Parse command-line options
+	Options opts;
+	bool seeded = false;
+	std::string inputPath, outputPath;
+	std::vector<std::string> args(argv + 1, argv + argc);
+	std::vector<const StrategyInfo *> selected(1, findStrategy("serial"));
+	for (size_t i = 0; i < args.size(); i++)
 	{
-		std::cout << "Number of ranks = " << worldSize << std::endl << std::endl;
-
-		//! Obtain angles from slaves (1 to N-1)
-		for (int i = 1; i < worldSize; i++)
+		std::string arg(args[i]);
+		if ((arg == "--config") && (i + 1 < args.size()))
 		{
-			//! Receive number of angles to help resize temp vector
-			MPI_Recv(&numAngles, 1, MPI_INT, i, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-			std::cout << "Received no. of angles = " << numAngles << " from rank " << i << std::endl;
-
-			//! Resize temp vector and receive the slave-angles
-			tmpVec.resize(static_cast<size_t>(numAngles));
-			MPI_Recv(&tmpVec[0], numAngles, MPI_DOUBLE, i, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-
-			std::cout << "Received vector by master: ";
-			for (size_t j = 0; j < tmpVec.size(); j++)
+			std::vector<std::string> tokens;
+			std::string error;
+			if (!readConfig(args[++i], tokens, error))
+				return startupError(worldRank, error);
+			args.insert(args.begin() + static_cast<std::ptrdiff_t>(i + 1), tokens.begin(), tokens.end());
+		}
+		else if (((arg == "--strategy") || (arg == "--mode")) && (i + 1 < args.size()))
+		{
+			selected.clear();
+			std::istringstream names(args[++i]);
+			std::string name;
+			while (std::getline(names, name, ','))
 			{
-				std::cout << tmpVec[j] << " ";
-
-				//! Populate master vector containing all angles obtained from slaves
-				masterVec.push_back(tmpVec[j]);
+				const StrategyInfo *info = findStrategy(name);
+				if (info == nullptr)
+					return startupError(worldRank, "Unknown strategy: " + name);
+				selected.push_back(info);
 			}
-			std::cout << std::endl << std::endl;
 		}
-
-		std::cout << "Master vector (" << masterVec.size() << "): ";
-		balancedSize = static_cast<int>(masterVec.size()) / (worldSize - 1);
-
-		for (size_t i = 0; i < masterVec.size(); i++)
-			std::cout << masterVec[i] << " ";
-		std::cout << std::endl << std::endl;
-
-		int count = 0;
-
-		//! Sending balanced vectors to slaves
-		for (int i = 1; i < worldSize; i++)
+		else if (arg == "--master-computes")
+			opts.masterComputes = true;
+		else if ((arg == "--balance") && (i + 1 < args.size()))
 		{
-			tmpVec.clear();
-
-			for (int j = 0; j < balancedSize; j++)
-				tmpVec.push_back(masterVec[count++]);
-
-			//! Push back any remaining angles in last rank
-			while ((count != masterVec.size()) && (i == worldSize - 1))
-				tmpVec.push_back(masterVec[count++]);
-
-			int tmpSize = static_cast<int>(tmpVec.size());
-			//! Send number of balanced angles to slaves
-			MPI_Send(&tmpSize, 1, MPI_INT, i, 0, MPI_COMM_WORLD);
-
-			//! Send balanced vector to slaves
-			MPI_Send(&tmpVec[0], tmpSize, MPI_DOUBLE, i, 0, MPI_COMM_WORLD);
+			std::string value(args[++i]);
+			if (value == "count")
+				opts.balance = Balance::COUNT;
+			else if (value == "weighted")
+				opts.balance = Balance::WEIGHTED;
+			else
+				return startupError(worldRank, "Unknown balance: " + value);
 		}
-
-		//! Prep master vector to store sin values
-		masterVec.clear();
-
-		//! Receive sin vector from slaves
-		for (int i = 1; i < worldSize; i++)
+		else if ((arg == "--wire") && (i + 1 < args.size()))
 		{
-			//! Receive number of angles to help resize temp vector
-			MPI_Recv(&numAngles, 1, MPI_INT, i, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+			std::string value(args[++i]);
+			if (value == "double")
+				opts.wire = Wire::DOUBLE;
+			else if (value == "float")
+				opts.wire = Wire::FLOAT;
+			else if (value == "fixed16")
+				opts.wire = Wire::FIXED16;
+			else
+				return startupError(worldRank, "Unknown wire format: " + value);
+		}
+		else if ((arg == "--cost") && (i + 1 < args.size()))
+		{
+			std::string value(args[++i]);
+			if (value == "unit")
+				opts.cost = unitCost;
+			else if (value == "range")
+				opts.cost = rangeReductionCost;
+			else
+				return startupError(worldRank, "Unknown cost model: " + value);
+		}
+		else if ((arg == "--iterations") && (i + 1 < args.size()))
+			opts.iterations = std::max(1, atoi(args[++i].c_str()));
+		else if (arg == "--feedback")
+			opts.feedback = true;
+		else if ((arg == "--schedule") && (i + 1 < args.size()))
+		{
+			std::string value(args[++i]);
+			if (value == "fixed")
+				opts.schedule = Schedule::FIXED;
+			else if (value == "guided")
+				opts.schedule = Schedule::GUIDED;
+			else
+				return startupError(worldRank, "Unknown schedule: " + value);
+		}
+		else if ((arg == "--chunk") && (i + 1 < args.size()))
+			opts.chunk = std::max(1, atoi(args[++i].c_str()));
+		else if ((arg == "--timeout") && (i + 1 < args.size()))
+			opts.timeout = std::max(0.0, atof(args[++i].c_str()));
+		else if (arg == "--speculate")
+			opts.speculate = true;
+		else if ((arg == "--checkpoint") && (i + 1 < args.size()))
+			opts.checkpoint = args[++i];
+		else if (arg == "--rank-stats")
+			opts.rankStats = true;
+		else if ((arg == "--verbosity") && (i + 1 < args.size()))
+			opts.verbosity = atoi(args[++i].c_str());
+		else if ((arg == "--threshold") && (i + 1 < args.size()))
+			opts.threshold = std::max(1.0, atof(args[++i].c_str()));
+		else if ((arg == "--drift") && (i + 1 < args.size()))
+			opts.drift = std::max(0.0, atof(args[++i].c_str()));
+		else if ((arg == "--node-size") && (i + 1 < args.size()))
+			opts.nodeSize = std::max(0, atoi(args[++i].c_str()));
+		else if ((arg == "--pipeline-chunk") && (i + 1 < args.size()))
+			opts.pipelineChunk = std::max(1, atoi(args[++i].c_str()));
+		else if ((arg == "--lut-error") && (i + 1 < args.size()))
+			opts.lutError = std::min(1.0e-1, std::max(1.0e-12, atof(args[++i].c_str())));
+		else if (arg == "--dedupe")
+			opts.dedupe = true;
+		else if (arg == "--huge-pages")
+			opts.hugePages = true;
+		else if ((arg == "--backend") && (i + 1 < args.size()))
+		{
+			std::string value(args[++i]);
+			if (value == "cpu")
+				opts.backend = Backend::CPU;
+#if defined(LOADBALANCE_GPU)
+			else if (value == "gpu")
+				opts.backend = Backend::GPU;
+#endif
+			else
+				return startupError(worldRank, "Unknown or unsupported backend: " + value);
+		}
+		else if ((arg == "--rank-weight") && (i + 1 < args.size()))
+			opts.rankWeight = atof(args[++i].c_str());
+		else if ((arg == "--threads") && (i + 1 < args.size()))
+			opts.threads = std::max(0, atoi(args[++i].c_str()));
+		else if ((arg == "--thread-schedule") && (i + 1 < args.size()))
+		{
+			std::string value(args[++i]);
+			if (value == "static")
+				opts.dynamicThreads = false;
+			else if (value == "dynamic")
+				opts.dynamicThreads = true;
+			else
+				return startupError(worldRank, "Unknown thread schedule: " + value);
+		}
+		else if ((arg == "--scaling") && (i + 1 < args.size()))
+		{
+			std::string value(args[++i]);
+			if (value == "random")
+				opts.scaling = Scaling::RANDOM;
+			else if (value == "strong")
+				opts.scaling = Scaling::STRONG;
+			else if (value == "weak")
+				opts.scaling = Scaling::WEAK;
+			else
+				return startupError(worldRank, "Unknown scaling: " + value);
+		}
+		else if ((arg == "--size") && (i + 1 < args.size()))
+			opts.size = std::max(0LL, atoll(args[++i].c_str()));
+		else if ((arg == "--distribution") && (i + 1 < args.size()))
+		{
+			std::string value(args[++i]);
+			if (value == "uniform")
+				opts.distribution = Distribution::UNIFORM;
+			else if (value == "zipf")
+				opts.distribution = Distribution::ZIPF;
+			else if (value == "heavy")
+				opts.distribution = Distribution::HEAVY;
+			else
+				return startupError(worldRank, "Unknown distribution: " + value);
+		}
+		else if ((arg == "--zipf-exponent") && (i + 1 < args.size()))
+			opts.zipfExponent = std::max(0.0, atof(args[++i].c_str()));
+		else if ((arg == "--heavy-ranks") && (i + 1 < args.size()))
+			opts.heavyRanks = std::max(0, atoi(args[++i].c_str()));
+		else if ((arg == "--heavy-factor") && (i + 1 < args.size()))
+			opts.heavyFactor = std::max(0.0, atof(args[++i].c_str()));
+		else if ((arg == "--count-min") && (i + 1 < args.size()))
+			opts.countMin = std::max(0LL, atoll(args[++i].c_str()));
+		else if ((arg == "--count-max") && (i + 1 < args.size()))
+			opts.countMax = std::max(0LL, atoll(args[++i].c_str()));
+		else if ((arg == "--angle-min") && (i + 1 < args.size()))
+			opts.angleMin = atof(args[++i].c_str());
+		else if ((arg == "--angle-max") && (i + 1 < args.size()))
+			opts.angleMax = atof(args[++i].c_str());
+		else if ((arg == "--seed") && (i + 1 < args.size()))
+		{
+			opts.seed = strtoull(args[++i].c_str(), nullptr, 10);
+			seeded = true;
+		}
+		else if ((arg == "--input") && (i + 1 < args.size()))
+			inputPath = args[++i];
+		else if ((arg == "--output") && (i + 1 < args.size()))
+			outputPath = args[++i];
+		else if (arg == "--keep-results")
+			opts.keepResults = true;
+		else if (arg == "--return-results")
+			opts.returnResults = true;
+		else if ((arg == "--window") && (i + 1 < args.size()))
+			opts.window = std::max(1LL, atoll(args[++i].c_str()));
+		else if (arg == "--bench")
+			opts.bench = true;
+		else if ((arg == "--warmup") && (i + 1 < args.size()))
+			opts.warmup = std::max(0, atoi(args[++i].c_str()));
+		else if ((arg == "--repeat") && (i + 1 < args.size()))
+			opts.repeat = std::max(1, atoi(args[++i].c_str()));
+		else if ((arg == "--bench-format") && (i + 1 < args.size()))
+		{
+			std::string value(args[++i]);
+			if (value == "csv")
+				opts.json = false;
+			else if ((value == "jsonl") || (value == "json"))
+				opts.json = true;
+			else
+				return startupError(worldRank, "Unknown benchmark format: " + value);
+		}
+		else if ((arg == "--bench-output") && (i + 1 < args.size()))
+			opts.benchOutput = args[++i];
+		else if ((arg == "--kernel") && (i + 1 < args.size()))
+		{
+			std::string value(args[++i]);
+			if (value == "auto")
+				opts.kernel = bestSineKernel();
+			else if (value == "libm")
+				opts.kernel = sineLibm;
+			else if (value == "lut")
+				opts.kernel = sineLookup;
+			else if (value == "scalar")
+				opts.kernel = sineScalar;
+#if defined(__GNUC__) && defined(__x86_64__)
+			else if ((value == "avx2") && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+				opts.kernel = sineAvx2;
+			else if ((value == "avx512") && __builtin_cpu_supports("avx512f"))
+				opts.kernel = sineAvx512;
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+			else if (value == "neon")
+				opts.kernel = sineNeon;
+#endif
+			else
+				return startupError(worldRank, "Unknown or unsupported kernel: " + value);
+		}
+		else
+		{
+			std::string names;
+			for (size_t s = 0; s < strategies().size(); s++)
+				names += ((s > 0) ? "|" : "") + strategies()[s].name;
+			std::ostringstream usage;
+			usage << "Usage: " << argv[0] << " [--config FILE] [--strategy " << names << "[,...]]"
+				  << " [--master-computes]"
+				  << " [--balance count|weighted] [--wire double|float|fixed16] [--cost unit|range]"
+				  << " [--iterations N] [--feedback] [--dedupe]"
+				  << " [--schedule fixed|guided] [--chunk N] [--kernel auto|libm|scalar|avx2|avx512|neon|lut]"
+				  << " [--lut-error E] [--timeout S] [--speculate] [--checkpoint FILE]"
+				  << " [--threads N] [--thread-schedule static|dynamic] [--huge-pages] [--backend cpu|gpu]"
+				  << " [--rank-weight W] [--pipeline-chunk N]"
+				  << " [--node-size N] [--threshold X] [--drift F]"
+				  << " [--verbosity 0|1|2] [--rank-stats] [--scaling random|strong|weak] [--size N]"
+				  << " [--count-min N] [--count-max N] [--angle-min X] [--angle-max X]"
+				  << " [--distribution uniform|zipf|heavy] [--zipf-exponent S] [--heavy-ranks K]"
+				  << " [--heavy-factor F] [--seed S] [--input FILE] [--output FILE] [--keep-results]"
+				  << " [--return-results] [--window N]"
+				  << " [--bench] [--warmup N] [--repeat N] [--bench-format csv|jsonl] [--bench-output FILE]";
+			return startupError(worldRank, usage.str());
+		}
+	}
 
-			//! Resize temp vector and receive the slave-angles
-			tmpVec.resize(static_cast<size_t>(numAngles));
-			MPI_Recv(&tmpVec[0], numAngles, MPI_DOUBLE, i, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+	if (opts.kernel == nullptr)
+		opts.kernel = bestSineKernel();
+	if (opts.kernel == sineLookup)
+		SineTable::instance().build(opts.lutError);
 
-			//! Populate master vector with sin values obtained from slaves
-			for (size_t j = 0; j < tmpVec.size(); j++)
-				masterVec.push_back(tmpVec[j]);
+	//! Compute threads of this rank
+	if (opts.threads == 0)
+		opts.threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+	if ((opts.threads > 1) && (provided < MPI_THREAD_FUNNELED))
+	{
+		if (worldRank == MASTER)
+			std::cerr << "MPI_THREAD_FUNNELED unavailable, computing with 1 thread per rank" << std::endl;
+		opts.threads = 1;
+	}
+	ThreadPool pool(opts.threads);
+	opts.pool = &pool;
+	BufferArena::instance().configure(&pool, opts.hugePages);
+
+	//! Options may differ per rank when it is launched with several executables (MPMD), so every rank checks
+	//! everyone's throughput weight and backend
+	std::vector<double> weights(static_cast<size_t>(worldSize));
+	MPI_Allgather(&opts.rankWeight, 1, MPI_DOUBLE, weights.data(), 1, MPI_DOUBLE, MPI_COMM_WORLD);
+	if (*std::min_element(weights.begin(), weights.end()) <= 0.0)
+		return startupError(worldRank, "Every --rank-weight must be positive");
+	if (std::count(weights.begin(), weights.end(), weights[0]) != worldSize)
+		opts.rankWeights = weights;
+
+	int gpu = (opts.backend == Backend::GPU) ? 1 : 0, anyGpu = 0;
+	MPI_Allreduce(&gpu, &anyGpu, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+
+	if ((worldSize < 2) && !opts.masterComputes)
+		return startupError(worldRank, "At least 2 ranks are required");
+
+	//! Every rank derives its streams from the master's seed, so a run is reproduced by passing it back
+	if (!seeded)
+		opts.seed = static_cast<uint64_t>(time(nullptr));
+	MPI_Bcast(&opts.seed, 1, MPI_UINT64_T, MASTER, MPI_COMM_WORLD);
+
+	//! Angles and sine values as flat binary arrays of doubles, opened collectively
+	if (!inputPath.empty())
+	{
+		MPI_Offset bytes = 0;
+		if (MPI_File_open(MPI_COMM_WORLD, inputPath.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &opts.input)
+			== MPI_SUCCESS)
+			MPI_File_get_size(opts.input, &bytes);
+		if ((opts.input == MPI_FILE_NULL) || (bytes % sizeof(double) != 0))
+		{
+			if (opts.input != MPI_FILE_NULL)
+				MPI_File_close(&opts.input);
+			return startupError(worldRank, "Cannot read " + inputPath + " as an array of doubles");
 		}
-
-		std::cout << "Final Master vector (" << masterVec.size() << "): ";
-		for (size_t i = 0; i < masterVec.size(); i++)
-			std::cout << masterVec[i] << " ";
-		std::cout << std::endl;
+		opts.inputSize = bytes / static_cast<MPI_Offset>(sizeof(double));
 	}
-	else
+	if (!outputPath.empty())
 	{
-		//! Seed randomizer
-		srand(time(nullptr) + worldRank);
-
-		//! Randomize number of angles in slave rank
-		numAngles = randomizer<int>(1, 50);
-
-		//! Send number of angles to master
-		MPI_Send(&numAngles, 1, MPI_INT, MASTER, 0, MPI_COMM_WORLD);
-
-		//! Push into an empty vector
-		slaveVec.clear();
-		for (int i = 0; i < numAngles; i++)
-			slaveVec.push_back(randomizer<double>(0.0, 360.0));
-
-		//! Send vector to master
-		MPI_Send(&slaveVec[0], numAngles, MPI_DOUBLE, MASTER, 0, MPI_COMM_WORLD);
-
-		//! Receive number of angles in balanced vector
-		MPI_Recv(&balancedSize, 1, MPI_INT, MASTER, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+		if (MPI_File_open(MPI_COMM_WORLD, outputPath.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL,
+						  &opts.output) != MPI_SUCCESS)
+		{
+			if (opts.input != MPI_FILE_NULL)
+				MPI_File_close(&opts.input);
+			return startupError(worldRank, "Cannot write " + outputPath);
+		}
+		MPI_File_set_size(opts.output, 0);
+	}
 
-		//! Resize slave vector and receive balanced vector of angles
-		slaveVec.resize(static_cast<size_t>(balancedSize));
-		MPI_Recv(&slaveVec[0], balancedSize, MPI_DOUBLE, MASTER, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+	//! Every selected strategy is checked before the first one runs
+	std::vector<Options> runs(selected.size(), opts);
+	bool valid = true;
+	for (size_t s = 0; valid && (s < runs.size()); s++)
+	{
+		applyStrategy(*selected[s], runs[s]);
+		valid = checkOptions(runs[s], worldSize, worldRank, anyGpu != 0);
+	}
+	if (!valid)
+	{
+		if (opts.input != MPI_FILE_NULL)
+			MPI_File_close(&opts.input);
+		if (opts.output != MPI_FILE_NULL)
+			MPI_File_close(&opts.output);
+		MPI_Finalize();
+		return EXIT_FAILURE;
+	}
 
-		std::cout << "Received vector by slave " << worldRank << " (" << slaveVec.size() << "): ";
-		for (size_t j = 0; j < slaveVec.size(); j++)
+	//! Strategies run one after another on the same input and seed, so they compare under one job allocation
+	for (size_t s = 0; s < runs.size(); s++)
+	{
+		if (runs[s].bench)
+			runBenchmark(runs[s], worldSize, worldRank);
+		else
 		{
-			std::cout << slaveVec[j] << "->";
+			RankStats stats;
+			runs[s].stats = &stats;
+			MPI_Barrier(MPI_COMM_WORLD);
+			double start = MPI_Wtime();
 
-			//! Calculate sin(x) in-place
-			slaveVec[j] = sin(slaveVec[j]);
+			runMode(runs[s], worldSize, worldRank);
 
-			std::cout << "(" << slaveVec[j] << ") ";
+			reportSummary(runs[s], worldSize, worldRank, stats, MPI_Wtime() - start);
 		}
-		std::cout << std::endl << std::endl;
-
-		//! Send number of angles in sin vector
-		MPI_Send(&balancedSize, 1, MPI_INT, MASTER, 0, MPI_COMM_WORLD);
-
-		//! Send sin vector back to master
-		MPI_Send(&slaveVec[0], balancedSize, MPI_DOUBLE, MASTER, 0, MPI_COMM_WORLD);
 	}
 
+	if (opts.output != MPI_FILE_NULL)
+		MPI_File_close(&opts.output);
+	if (opts.input != MPI_FILE_NULL)
+		MPI_File_close(&opts.input);
+
+	//! Part of the summary, which the benchmark output replaces
+	BufferArena& arena = BufferArena::instance();
+	if ((worldRank == MASTER) && (opts.verbosity >= VERBOSITY_SUMMARY) && !opts.bench)
+		std::cout << "Buffer arena: " << arena.allocated() << " blocks allocated, " << arena.reused() << " reused"
+				  << std::endl;
+	arena.release();
+
 	//! Finalize MPI
 	MPI_Finalize();
 
@@ -0,0 +1,223 @@
+/**
+* @file This file is part of LoadBalance.
+*
+* @section LICENSE
+* MIT License
+*
+* Copyright (c) 2018 Rajdeep Konwar
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+* @section DESCRIPTION
+* Micro-benchmarks of the partitioner and the compute kernels on a single rank
+**/
+
+#include <benchmark/benchmark.h>
+
+#include "Modes.h"
+
+//! Angles of the generated input range, the same for every benchmark
+ArenaVector<double> benchAngles(const size_t n, const double high = 360.0)
+{
+	ArenaVector<double> angles(n);
+	Xoshiro256 rng(1, 0, STREAM_ANGLES);
+	for (size_t i = 0; i < n; i++)
+		angles[i] = rng.uniform(0.0, high);
+
+	return angles;
+}
+
+//! One batch kernel over state.range(0) angles
+void kernelBenchmark(benchmark::State& state, const SineKernel kernel, const double high)
+{
+	ArenaVector<double> in = benchAngles(static_cast<size_t>(state.range(0)), high), out(in.size());
+	for (auto _ : state)
+	{
+		kernel(in.data(), out.data(), in.size());
+		benchmark::DoNotOptimize(out.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_SineLibm(benchmark::State& state)
+{
+	kernelBenchmark(state, sineLibm, 360.0);
+}
+
+void BM_SineScalar(benchmark::State& state)
+{
+	kernelBenchmark(state, sineScalar, 360.0);
+}
+
+#if defined(__GNUC__) && defined(__x86_64__)
+void BM_SineAvx2(benchmark::State& state)
+{
+	if (!__builtin_cpu_supports("avx2") || !__builtin_cpu_supports("fma"))
+	{
+		state.SkipWithError("AVX2/FMA unsupported");
+		return;
+	}
+	kernelBenchmark(state, sineAvx2, 360.0);
+}
+
+void BM_SineAvx512(benchmark::State& state)
+{
+	if (!__builtin_cpu_supports("avx512f"))
+	{
+		state.SkipWithError("AVX-512 unsupported");
+		return;
+	}
+	kernelBenchmark(state, sineAvx512, 360.0);
+}
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+void BM_SineNeon(benchmark::State& state)
+{
+	kernelBenchmark(state, sineNeon, 360.0);
+}
+#endif
+
+void BM_SineLookup(benchmark::State& state)
+{
+	SineTable::instance().build(LUT_ERROR);
+	kernelBenchmark(state, sineLookup, 360.0);
+}
+
+//! The dispatched kernel on large arguments, where range reduction dominates
+void BM_SineLargeArguments(benchmark::State& state)
+{
+	kernelBenchmark(state, bestSineKernel(), SINE_MAX_ARG);
+}
+
+//! The dispatched kernel split across state.range(1) compute threads
+void BM_RunKernel(benchmark::State& state)
+{
+	ThreadPool pool(static_cast<int>(state.range(1)));
+	Options opts;
+	opts.kernel = bestSineKernel();
+	opts.threads = pool.size();
+	opts.pool = &pool;
+	ArenaVector<double> in = benchAngles(static_cast<size_t>(state.range(0))), out(in.size());
+	for (auto _ : state)
+	{
+		runKernel(opts, in.data(), out.data(), in.size());
+		benchmark::DoNotOptimize(out.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+//! Count balancing of 10^9 angles over state.range(0) ranks
+void BM_BalancedCounts(benchmark::State& state)
+{
+	const int ranks = static_cast<int>(state.range(0));
+	for (auto _ : state)
+		benchmark::DoNotOptimize(balancedCounts(1000000000LL, ranks, false));
+}
+
+//! Capacity-proportional split of 10^9 angles over state.range(0) ranks of different throughput
+void BM_ProportionalCounts(benchmark::State& state)
+{
+	ArenaVector<double> capacity(static_cast<size_t>(state.range(0)));
+	for (size_t r = 0; r < capacity.size(); r++)
+		capacity[r] = 1.0 + static_cast<double>(r % 4);
+	for (auto _ : state)
+		benchmark::DoNotOptimize(proportionalCounts(1000000000LL, capacity));
+}
+
+//! Cost estimate and weighted split of state.range(0) angles over 64 ranks, as the master partitions them
+void BM_MasterPartition(benchmark::State& state)
+{
+	Options opts;
+	opts.balance = Balance::WEIGHTED;
+	ArenaVector<double> angles = benchAngles(static_cast<size_t>(state.range(0)), SINE_MAX_ARG);
+	ArenaVector<double> capacity = initialCapacity(opts, 64);
+	for (auto _ : state)
+	{
+		ArenaVector<double> weights = angleWeights(opts, angles);
+		benchmark::DoNotOptimize(masterPartition(opts, angles, weights, capacity));
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+//! Weighted split alone, over precomputed costs
+void BM_WeightedCounts(benchmark::State& state)
+{
+	Options opts;
+	ArenaVector<double> weights = angleWeights(opts, benchAngles(static_cast<size_t>(state.range(0)), SINE_MAX_ARG));
+	ArenaVector<double> capacity = initialCapacity(opts, 64);
+	double totalWeight = std::accumulate(weights.begin(), weights.end(), 0.0);
+	for (auto _ : state)
+		benchmark::DoNotOptimize(weightedCounts(weights, 0.0, totalWeight, capacity));
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+//! Deduplication of state.range(0) angles drawn from 1024 distinct values
+void BM_DedupeValues(benchmark::State& state)
+{
+	ArenaVector<double> values = benchAngles(static_cast<size_t>(state.range(0)));
+	for (size_t i = 0; i < values.size(); i++)
+		values[i] = std::floor(values[i] * 1024.0 / 360.0);
+	ArenaVector<double> distinct;
+	std::vector<long long> index;
+	for (auto _ : state)
+	{
+		dedupeValues(values, distinct, index);
+		benchmark::DoNotOptimize(distinct.data());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_SineLibm)->RangeMultiplier(16)->Range(1 << 10, 1 << 22);
+BENCHMARK(BM_SineScalar)->RangeMultiplier(16)->Range(1 << 10, 1 << 22);
+#if defined(__GNUC__) && defined(__x86_64__)
+BENCHMARK(BM_SineAvx2)->RangeMultiplier(16)->Range(1 << 10, 1 << 22);
+BENCHMARK(BM_SineAvx512)->RangeMultiplier(16)->Range(1 << 10, 1 << 22);
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+BENCHMARK(BM_SineNeon)->RangeMultiplier(16)->Range(1 << 10, 1 << 22);
+#endif
+BENCHMARK(BM_SineLookup)->RangeMultiplier(16)->Range(1 << 10, 1 << 22);
+BENCHMARK(BM_SineLargeArguments)->Arg(1 << 16);
+BENCHMARK(BM_RunKernel)->ArgsProduct({{1 << 16, 1 << 22}, {1, 2, 4}})->UseRealTime();
+BENCHMARK(BM_BalancedCounts)->RangeMultiplier(8)->Range(8, 1 << 15);
+BENCHMARK(BM_ProportionalCounts)->RangeMultiplier(8)->Range(8, 1 << 15);
+BENCHMARK(BM_MasterPartition)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK(BM_WeightedCounts)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK(BM_DedupeValues)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+
+//! Buffers come from MPI_Alloc_mem and the compute kernels time themselves with MPI_Wtime, so the benchmarks run
+//! inside MPI on one rank
+int main(int argc, char **argv)
+{
+	int provided;
+	MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv))
+	{
+		MPI_Finalize();
+		return EXIT_FAILURE;
+	}
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+
+	BufferArena::instance().release();
+	MPI_Finalize();
+	return EXIT_SUCCESS;
+}
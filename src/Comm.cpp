@@ -0,0 +1,367 @@
+/**
+* @file This file is part of LoadBalance.
+*
+* @section LICENSE
+* MIT License
+*
+* Copyright (c) 2018 Rajdeep Konwar
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*
+* @section DESCRIPTION
+* Traced point-to-point and collective communication, large counts and wire formats
+**/
+
+#include "Comm.h"
+
+void countBytes(const Options& opts, const long long sent, const long long received)
+{
+	if (opts.stats != nullptr)
+	{
+		opts.stats->bytesSent += sent;
+		opts.stats->bytesReceived += received;
+	}
+}
+
+long long typeBytes(const long long count, const MPI_Datatype type)
+{
+	int size;
+	MPI_Type_size(type, &size);
+
+	return count * size;
+}
+
+void endWait(const Options& opts, const double start)
+{
+	if (opts.stats != nullptr)
+		opts.stats->waitTime += MPI_Wtime() - start;
+}
+
+long long receivedCount(const MPI_Status *status, const long long count, const MPI_Datatype type)
+{
+	LargeCount large(count, type);
+	MPI_Count received;
+	MPI_Get_elements_x(status, large.type(), &received);
+
+	return received;
+}
+
+int traceSend(const Options& opts, const void *buf, const long long count, const MPI_Datatype type, const int dest,
+			  const int tag, const MPI_Comm comm)
+{
+	LargeCount large(count, type);
+	double start = MPI_Wtime();
+	int err = MPI_Send(buf, large.count(), large.type(), dest, tag, comm);
+	endWait(opts, start);
+	countBytes(opts, typeBytes(count, type), 0);
+
+	return err;
+}
+
+int traceRecv(const Options& opts, void *buf, const long long count, const MPI_Datatype type, const int source,
+			  const int tag, const MPI_Comm comm, MPI_Status *status)
+{
+	MPI_Status local;
+	if (status == MPI_STATUS_IGNORE)
+		status = &local;
+
+	LargeCount large(count, type);
+	double start = MPI_Wtime();
+	int err = MPI_Recv(buf, large.count(), large.type(), source, tag, comm, status);
+	endWait(opts, start);
+
+	countBytes(opts, 0, typeBytes(receivedCount(status, count, type), type));
+
+	return err;
+}
+
+long long traceMprobe(const Options& opts, const int source, const int tag, const MPI_Comm comm,
+					  const MPI_Datatype type, MPI_Message *message, MPI_Status *status)
+{
+	double start = MPI_Wtime();
+	MPI_Mprobe(source, tag, comm, message, status);
+	endWait(opts, start);
+
+	MPI_Count count;
+	MPI_Get_elements_x(status, type, &count);
+	return count;
+}
+
+int traceMrecv(const Options& opts, void *buf, const long long count, const MPI_Datatype type, MPI_Message *message)
+{
+	LargeCount large(count, type);
+	double start = MPI_Wtime();
+	int err = MPI_Mrecv(buf, large.count(), large.type(), message, MPI_STATUS_IGNORE);
+	endWait(opts, start);
+	countBytes(opts, 0, typeBytes(count, type));
+
+	return err;
+}
+
+int traceIsend(const Options& opts, const void *buf, const long long count, const MPI_Datatype type,
+			   const int dest, const int tag, const MPI_Comm comm, MPI_Request *request)
+{
+	countBytes(opts, typeBytes(count, type), 0);
+
+	LargeCount large(count, type);
+	return MPI_Isend(buf, large.count(), large.type(), dest, tag, comm, request);
+}
+
+int traceIrecv(const Options& opts, void *buf, const long long count, const MPI_Datatype type,
+			   const int source, const int tag, const MPI_Comm comm, MPI_Request *request)
+{
+	countBytes(opts, 0, typeBytes(count, type));
+
+	LargeCount large(count, type);
+	return MPI_Irecv(buf, large.count(), large.type(), source, tag, comm, request);
+}
+
+int traceWait(const Options& opts, MPI_Request *request, MPI_Status *status)
+{
+	double start = MPI_Wtime();
+	int err = MPI_Wait(request, status);
+	endWait(opts, start);
+
+	return err;
+}
+
+int traceTest(const Options& opts, MPI_Request *request, int *flag, MPI_Status *status)
+{
+	double start = MPI_Wtime();
+	int err = MPI_Test(request, flag, status);
+	endWait(opts, start);
+
+	return err;
+}
+
+int traceWaitall(const Options& opts, const int count, MPI_Request *requests, MPI_Status *statuses)
+{
+	double start = MPI_Wtime();
+	int err = MPI_Waitall(count, requests, statuses);
+	endWait(opts, start);
+
+	return err;
+}
+
+int traceStartWaitall(const Options& opts, const int count, MPI_Request *requests)
+{
+	double start = MPI_Wtime();
+	MPI_Startall(count, requests);
+	int err = MPI_Waitall(count, requests, MPI_STATUSES_IGNORE);
+	endWait(opts, start);
+
+	return err;
+}
+
+long long othersCount(const long long *counts, const MPI_Comm comm)
+{
+	int size, rank;
+	MPI_Comm_size(comm, &size);
+	MPI_Comm_rank(comm, &rank);
+	long long total = 0;
+	for (int r = 0; r < size; r++)
+		if (r != rank)
+			total += counts[r];
+
+	return total;
+}
+
+bool anyLarge(const long long *values, const int n, const MPI_Comm comm)
+{
+	int large = 0;
+	for (int i = 0; i < n; i++)
+		if (values[i] > INT_COUNT_MAX)
+			large = 1;
+
+	int anyLarge;
+	MPI_Allreduce(&large, &anyLarge, 1, MPI_INT, MPI_LOR, comm);
+
+	return anyLarge != 0;
+}
+
+std::vector<int> intCounts(const long long *values, const int n)
+{
+	return std::vector<int>(values, values + n);
+}
+
+int traceGatherv(const Options& opts, const void *sendBuf, const long long sendCount, const MPI_Datatype sendType,
+				 void *recvBuf, const long long *recvCounts, const long long *displs, const MPI_Datatype recvType,
+				 const int root, const MPI_Comm comm)
+{
+	int size, rank;
+	MPI_Comm_size(comm, &size);
+	MPI_Comm_rank(comm, &rank);
+	std::vector<long long> local(1, sendCount);
+	if (rank == root)
+	{
+		countBytes(opts, 0, typeBytes(othersCount(recvCounts, comm), recvType));
+		local.insert(local.end(), recvCounts, recvCounts + size);
+		local.insert(local.end(), displs, displs + size);
+	}
+	else
+		countBytes(opts, typeBytes(sendCount, sendType), 0);
+
+	double start = MPI_Wtime();
+	int err;
+	if (!anyLarge(local.data(), static_cast<int>(local.size()), comm))
+	{
+		std::vector<int> counts, offsets;
+		if (rank == root)
+		{
+			counts = intCounts(recvCounts, size);
+			offsets = intCounts(displs, size);
+		}
+		err = MPI_Gatherv(sendBuf, static_cast<int>(sendCount), sendType, recvBuf, counts.data(), offsets.data(),
+						  recvType, root, comm);
+	}
+	else
+	{
+		std::vector<MPI_Request> requests;
+		if (rank == root)
+			for (int r = 0; r < size; r++)
+				if (recvCounts[r] > 0)
+				{
+					LargeCount large(recvCounts[r], recvType);
+					requests.emplace_back();
+					MPI_Irecv(offsetBuffer(recvBuf, displs[r], recvType), large.count(), large.type(), r, TAG_LARGE,
+							  comm, &requests.back());
+				}
+		if (sendCount > 0)
+		{
+			LargeCount large(sendCount, sendType);
+			requests.emplace_back();
+			MPI_Isend(sendBuf, large.count(), large.type(), root, TAG_LARGE, comm, &requests.back());
+		}
+		err = MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+	}
+	endWait(opts, start);
+
+	return err;
+}
+
+int traceScatterv(const Options& opts, const void *sendBuf, const long long *sendCounts, const long long *displs,
+				  const MPI_Datatype sendType, void *recvBuf, const long long recvCount, const MPI_Datatype recvType,
+				  const int root, const MPI_Comm comm)
+{
+	int size, rank;
+	MPI_Comm_size(comm, &size);
+	MPI_Comm_rank(comm, &rank);
+	std::vector<long long> local(1, recvCount);
+	if (rank == root)
+	{
+		countBytes(opts, typeBytes(othersCount(sendCounts, comm), sendType), 0);
+		local.insert(local.end(), sendCounts, sendCounts + size);
+		local.insert(local.end(), displs, displs + size);
+	}
+	else
+		countBytes(opts, 0, typeBytes(recvCount, recvType));
+
+	double start = MPI_Wtime();
+	int err;
+	if (!anyLarge(local.data(), static_cast<int>(local.size()), comm))
+	{
+		std::vector<int> counts, offsets;
+		if (rank == root)
+		{
+			counts = intCounts(sendCounts, size);
+			offsets = intCounts(displs, size);
+		}
+		err = MPI_Scatterv(sendBuf, counts.data(), offsets.data(), sendType, recvBuf, static_cast<int>(recvCount),
+						   recvType, root, comm);
+	}
+	else
+	{
+		std::vector<MPI_Request> requests;
+		if (recvCount > 0)
+		{
+			LargeCount large(recvCount, recvType);
+			requests.emplace_back();
+			MPI_Irecv(recvBuf, large.count(), large.type(), root, TAG_LARGE, comm, &requests.back());
+		}
+		if (rank == root)
+			for (int r = 0; r < size; r++)
+				if (sendCounts[r] > 0)
+				{
+					LargeCount large(sendCounts[r], sendType);
+					requests.emplace_back();
+					MPI_Isend(offsetBuffer(sendBuf, displs[r], sendType), large.count(), large.type(), r, TAG_LARGE,
+							  comm, &requests.back());
+				}
+		err = MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+	}
+	endWait(opts, start);
+
+	return err;
+}
+
+int traceAlltoallv(const Options& opts, const void *sendBuf, const long long *sendCounts,
+				   const long long *sendDispls, const MPI_Datatype sendType, void *recvBuf,
+				   const long long *recvCounts, const long long *recvDispls, const MPI_Datatype recvType,
+				   const MPI_Comm comm)
+{
+	int size;
+	MPI_Comm_size(comm, &size);
+	countBytes(opts, typeBytes(othersCount(sendCounts, comm), sendType),
+			   typeBytes(othersCount(recvCounts, comm), recvType));
+
+	std::vector<long long> local(sendCounts, sendCounts + size);
+	local.insert(local.end(), sendDispls, sendDispls + size);
+	local.insert(local.end(), recvCounts, recvCounts + size);
+	local.insert(local.end(), recvDispls, recvDispls + size);
+
+	double start = MPI_Wtime();
+	int err;
+	if (!anyLarge(local.data(), static_cast<int>(local.size()), comm))
+	{
+		std::vector<int> sc = intCounts(sendCounts, size), sd = intCounts(sendDispls, size);
+		std::vector<int> rc = intCounts(recvCounts, size), rd = intCounts(recvDispls, size);
+		err = MPI_Alltoallv(sendBuf, sc.data(), sd.data(), sendType, recvBuf, rc.data(), rd.data(), recvType, comm);
+	}
+	else
+	{
+		std::vector<MPI_Request> requests;
+		for (int r = 0; r < size; r++)
+			if (recvCounts[r] > 0)
+			{
+				LargeCount large(recvCounts[r], recvType);
+				requests.emplace_back();
+				MPI_Irecv(offsetBuffer(recvBuf, recvDispls[r], recvType), large.count(), large.type(), r, TAG_LARGE,
+						  comm, &requests.back());
+			}
+		for (int r = 0; r < size; r++)
+			if (sendCounts[r] > 0)
+			{
+				LargeCount large(sendCounts[r], sendType);
+				requests.emplace_back();
+				MPI_Isend(offsetBuffer(sendBuf, sendDispls[r], sendType), large.count(), large.type(), r, TAG_LARGE,
+						  comm, &requests.back());
+			}
+		err = MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+	}
+	endWait(opts, start);
+
+	return err;
+}
+
+void recordHeld(const Options& opts, const long long held)
+{
+	if (opts.stats != nullptr)
+		opts.stats->held = held;
+}
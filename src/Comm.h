@@ -0,0 +1,363 @@
+/**
+* @file This file is part of LoadBalance.
+*
+* @section LICENSE
+* MIT License
+*
+* Copyright (c) 2018 Rajdeep Konwar
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*
+* @section DESCRIPTION
+* Traced point-to-point and collective communication, large counts and wire formats
+**/
+
+#ifndef LOADBALANCE_COMM_H
+#define LOADBALANCE_COMM_H
+
+#include <complex>
+#include <limits>
+#include <type_traits>
+
+#include "Runtime.h"
+
+//! Message tags of the point-to-point phases (angles to the master, slices to the ranks, sine values back),
+//! of collectives too large for int counts and of the diffusion load exchange
+#define TAG_WORK	1
+#define TAG_RESULT	2
+#define TAG_LARGE	3
+#define TAG_LOAD	4
+#define TAG_ANGLES	5
+
+//! MPI-3 takes element counts as int, so messages of more than INT_COUNT_MAX elements are described as one
+//! element of a derived datatype made of LARGE_BLOCK sized blocks plus a remainder
+const long long INT_COUNT_MAX = std::numeric_limits<int>::max();
+const long long LARGE_BLOCK = 1LL << 30;
+
+//! A count and datatype MPI accepts for count elements of type: the pair itself when the count fits an int,
+//! otherwise a single element of a committed derived type that is freed on destruction. MPI lets a type be
+//! freed while non-blocking operations using it are still pending.
+class LargeCount
+{
+public:
+	LargeCount(const long long count, const MPI_Datatype type) : m_type(type), m_count(static_cast<int>(count))
+	{
+		if (count <= INT_COUNT_MAX)
+			return;
+
+		MPI_Datatype block, body;
+		MPI_Type_contiguous(static_cast<int>(LARGE_BLOCK), type, &block);
+		MPI_Type_contiguous(static_cast<int>(count / LARGE_BLOCK), block, &body);
+		int rest = static_cast<int>(count % LARGE_BLOCK);
+		if (rest == 0)
+			m_type = body;
+		else
+		{
+			MPI_Aint lb, extent;
+			MPI_Type_get_extent(type, &lb, &extent);
+
+			MPI_Datatype tail;
+			MPI_Type_contiguous(rest, type, &tail);
+
+			int lengths[2] = {1, 1};
+			MPI_Aint displs[2] = {0, static_cast<MPI_Aint>(count - rest) * extent};
+			MPI_Datatype types[2] = {body, tail};
+			MPI_Type_create_struct(2, lengths, displs, types, &m_type);
+			MPI_Type_free(&body);
+			MPI_Type_free(&tail);
+		}
+		MPI_Type_free(&block);
+		MPI_Type_commit(&m_type);
+		m_count = 1;
+		m_derived = true;
+	}
+
+	~LargeCount()
+	{
+		if (m_derived)
+			MPI_Type_free(&m_type);
+	}
+
+	LargeCount(const LargeCount&) = delete;
+	LargeCount& operator=(const LargeCount&) = delete;
+
+	int count() const
+	{
+		return m_count;
+	}
+
+	MPI_Datatype type() const
+	{
+		return m_type;
+	}
+
+private:
+	MPI_Datatype m_type;
+	int m_count;
+	bool m_derived = false;
+};
+
+//! Address of element index of a buffer of type
+template <typename Buffer>
+Buffer *offsetBuffer(Buffer *buf, const long long index, const MPI_Datatype type)
+{
+	MPI_Aint lb, extent;
+	MPI_Type_get_extent(type, &lb, &extent);
+
+	return static_cast<Buffer *>(static_cast<typename std::conditional<std::is_const<Buffer>::value, const char,
+												char>::type *>(buf) + index * extent);
+}
+
+//! MPI datatype of an element type, resolved at compile time. Types without a specialization do not compile.
+template <typename T>
+struct MpiType
+{
+	static_assert(sizeof(T) == 0, "No MPI datatype for this element type: specialize MpiType");
+};
+
+#define DEFINE_MPI_TYPE(T, TYPE) \
+	template <> \
+	struct MpiType<T> \
+	{ \
+		static MPI_Datatype get() \
+		{ \
+			return TYPE; \
+		} \
+	};
+
+DEFINE_MPI_TYPE(float, MPI_FLOAT)
+DEFINE_MPI_TYPE(double, MPI_DOUBLE)
+DEFINE_MPI_TYPE(long double, MPI_LONG_DOUBLE)
+DEFINE_MPI_TYPE(int16_t, MPI_INT16_T)
+DEFINE_MPI_TYPE(uint16_t, MPI_UINT16_T)
+DEFINE_MPI_TYPE(int, MPI_INT)
+DEFINE_MPI_TYPE(long long, MPI_LONG_LONG)
+DEFINE_MPI_TYPE(unsigned int, MPI_UNSIGNED)
+DEFINE_MPI_TYPE(unsigned long long, MPI_UNSIGNED_LONG_LONG)
+DEFINE_MPI_TYPE(std::complex<float>, MPI_CXX_FLOAT_COMPLEX)
+DEFINE_MPI_TYPE(std::complex<double>, MPI_CXX_DOUBLE_COMPLEX)
+
+//! Base for the MpiType of a trivially copyable struct, which is then moved as sizeof(T) raw bytes:
+//!     template <> struct MpiType<Particle> : MpiBytes<Particle> {};
+//! The datatype is committed on first use, after MPI_Init, and lives until MPI_Finalize.
+template <typename T>
+struct MpiBytes
+{
+	static_assert(std::is_trivially_copyable<T>::value, "MpiBytes needs a trivially copyable type");
+
+	static MPI_Datatype get()
+	{
+		static MPI_Datatype type = commitBytes(sizeof(T));
+		return type;
+	}
+
+private:
+	static MPI_Datatype commitBytes(const size_t size)
+	{
+		MPI_Datatype type;
+		MPI_Type_contiguous(static_cast<int>(size), MPI_BYTE, &type);
+		MPI_Type_commit(&type);
+
+		return type;
+	}
+};
+
+//! Codecs of the wire formats. Angle and Sine are the element types sent; encode and decode convert single values
+//! so the conversion loops inline.
+struct DoubleWire
+{
+	typedef double Angle;
+	typedef double Sine;
+
+	static Angle encodeAngle(const double angle)
+	{
+		return angle;
+	}
+
+	static double decodeAngle(const Angle angle)
+	{
+		return angle;
+	}
+
+	static Sine encodeSine(const double sine)
+	{
+		return sine;
+	}
+
+	static double decodeSine(const Sine sine)
+	{
+		return sine;
+	}
+};
+
+struct FloatWire
+{
+	typedef float Angle;
+	typedef float Sine;
+
+	static Angle encodeAngle(const double angle)
+	{
+		return static_cast<float>(angle);
+	}
+
+	static double decodeAngle(const Angle angle)
+	{
+		return angle;
+	}
+
+	static Sine encodeSine(const double sine)
+	{
+		return static_cast<float>(sine);
+	}
+
+	static double decodeSine(const Sine sine)
+	{
+		return sine;
+	}
+};
+
+//! Angles in steps of 360/65536 (at most 0.0028 off) and sine values in steps of 1/32767 (at most 1.6e-5 off).
+//! Values outside the ranges are clamped.
+struct Fixed16Wire
+{
+	typedef uint16_t Angle;
+	typedef int16_t Sine;
+
+	static Angle encodeAngle(const double angle)
+	{
+		return static_cast<Angle>(std::min(std::max(std::lround(angle * (65536.0 / 360.0)), 0L), 65535L));
+	}
+
+	static double decodeAngle(const Angle angle)
+	{
+		return angle * (360.0 / 65536.0);
+	}
+
+	static Sine encodeSine(const double sine)
+	{
+		return static_cast<Sine>(std::min(std::max(std::lround(sine * 32767.0), -32767L), 32767L));
+	}
+
+	static double decodeSine(const Sine sine)
+	{
+		return sine * (1.0 / 32767.0);
+	}
+};
+
+//! Values in their wire format: encoded into wire, or the values themselves if they already are doubles
+template <typename V, typename Encode>
+const ArenaVector<V>& toWire(const ArenaVector<double>& values, ArenaVector<V>& wire, Encode encode)
+{
+	wire.resize(values.size());
+	for (size_t i = 0; i < values.size(); i++)
+		wire[i] = encode(values[i]);
+
+	return wire;
+}
+
+template <typename Encode>
+const ArenaVector<double>& toWire(const ArenaVector<double>& values, ArenaVector<double>&, Encode)
+{
+	return values;
+}
+
+//! Decode received values, or take them over without a copy if they are doubles
+template <typename V, typename Decode>
+void fromWire(ArenaVector<V>& wire, ArenaVector<double>& values, Decode decode)
+{
+	values.resize(wire.size());
+	for (size_t i = 0; i < wire.size(); i++)
+		values[i] = decode(wire[i]);
+}
+
+template <typename Decode>
+void fromWire(ArenaVector<double>& wire, ArenaVector<double>& values, Decode)
+{
+	values.swap(wire);
+}
+
+//! Instrumentation around the communication call sites. The trace wrappers take the MPI arguments plus the
+//! options holding this rank's stats; they count the bytes moved to and from other ranks and the time blocked
+//! as wait time. Non-blocking receives are counted at their posted size.
+void countBytes(const Options& opts, const long long sent, const long long received);
+
+long long typeBytes(const long long count, const MPI_Datatype type);
+
+//! Charge the time since start to this rank's wait time
+void endWait(const Options& opts, const double start);
+
+//! Elements of type received into a buffer posted for count of them
+long long receivedCount(const MPI_Status *status, const long long count, const MPI_Datatype type);
+
+int traceSend(const Options& opts, const void *buf, const long long count, const MPI_Datatype type, const int dest,
+			  const int tag, const MPI_Comm comm);
+
+int traceRecv(const Options& opts, void *buf, const long long count, const MPI_Datatype type, const int source,
+			  const int tag, const MPI_Comm comm, MPI_Status *status);
+
+//! Match the next message from source with tag and return its number of elements of type, so the receive is
+//! sized without a separate count message. The matched message is received with traceMrecv.
+long long traceMprobe(const Options& opts, const int source, const int tag, const MPI_Comm comm,
+					  const MPI_Datatype type, MPI_Message *message, MPI_Status *status);
+
+int traceMrecv(const Options& opts, void *buf, const long long count, const MPI_Datatype type, MPI_Message *message);
+
+int traceIsend(const Options& opts, const void *buf, const long long count, const MPI_Datatype type,
+			   const int dest, const int tag, const MPI_Comm comm, MPI_Request *request);
+
+int traceIrecv(const Options& opts, void *buf, const long long count, const MPI_Datatype type,
+			   const int source, const int tag, const MPI_Comm comm, MPI_Request *request);
+
+int traceWait(const Options& opts, MPI_Request *request, MPI_Status *status);
+
+int traceTest(const Options& opts, MPI_Request *request, int *flag, MPI_Status *status);
+
+int traceWaitall(const Options& opts, const int count, MPI_Request *requests, MPI_Status *statuses);
+
+//! Start persistent requests and wait for all of them; the caller counts their bytes
+int traceStartWaitall(const Options& opts, const int count, MPI_Request *requests);
+
+//! Sum of counts over every rank but this one
+long long othersCount(const long long *counts, const MPI_Comm comm);
+
+//! Whether any rank of comm has a count or displacement of a vector collective beyond an int. The
+//! collectives below then run as point-to-point messages with large counts instead.
+bool anyLarge(const long long *values, const int n, const MPI_Comm comm);
+
+//! Counts and displacements of a vector collective that are known to fit an int
+std::vector<int> intCounts(const long long *values, const int n);
+
+int traceGatherv(const Options& opts, const void *sendBuf, const long long sendCount, const MPI_Datatype sendType,
+				 void *recvBuf, const long long *recvCounts, const long long *displs, const MPI_Datatype recvType,
+				 const int root, const MPI_Comm comm);
+
+int traceScatterv(const Options& opts, const void *sendBuf, const long long *sendCounts, const long long *displs,
+				  const MPI_Datatype sendType, void *recvBuf, const long long recvCount, const MPI_Datatype recvType,
+				  const int root, const MPI_Comm comm);
+
+int traceAlltoallv(const Options& opts, const void *sendBuf, const long long *sendCounts,
+				   const long long *sendDispls, const MPI_Datatype sendType, void *recvBuf,
+				   const long long *recvCounts, const long long *recvDispls, const MPI_Datatype recvType,
+				   const MPI_Comm comm);
+
+//! Record the number of angles a rank holds once rebalanced
+void recordHeld(const Options& opts, const long long held);
+
+#endif
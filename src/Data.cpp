@@ -0,0 +1,274 @@
+/**
+* @file This file is part of LoadBalance.
+*
+* @section LICENSE
+* MIT License
+*
+* Copyright (c) 2018 Rajdeep Konwar
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*
+* @section DESCRIPTION
+* Generating, reading, reporting and writing angles and sine values
+**/
+
+#include "Data.h"
+
+std::vector<long long> generatedCounts(const Options& opts, const int worldSize)
+{
+	int generators = std::max(1, worldSize - 1);
+	long long total = (opts.scaling == Scaling::STRONG) ? opts.size : opts.size * generators;
+
+	ArenaVector<double> shares(static_cast<size_t>(generators), 1.0);
+	for (int k = 0; k < generators; k++)
+	{
+		if (opts.distribution == Distribution::ZIPF)
+			shares[k] = 1.0 / std::pow(static_cast<double>(k + 1), opts.zipfExponent);
+		else if ((opts.distribution == Distribution::HEAVY) && (k < opts.heavyRanks))
+			shares[k] = opts.heavyFactor;
+	}
+
+	double totalShare = 0.0;
+	for (int k = 0; k < generators; k++)
+		totalShare += shares[k];
+
+	std::vector<long long> counts(static_cast<size_t>(generators));
+	double prefix = 0.0;
+	long long assigned = 0;
+	for (int k = 0; k < generators; k++)
+	{
+		prefix += shares[k];
+		long long end = (k == generators - 1) ? total
+						: static_cast<long long>(std::floor(static_cast<double>(total) * (prefix / totalShare)));
+		counts[k] = end - assigned;
+		assigned = end;
+	}
+
+	return counts;
+}
+
+long long generatedCount(const Options& opts, const int worldSize, const int worldRank)
+{
+	if (opts.scaling == Scaling::RANDOM)
+		return Xoshiro256(opts.seed, worldRank, STREAM_COUNT).uniformInt(opts.countMin, opts.countMax);
+
+	return generatedCounts(opts, worldSize)[worldRank - 1];
+}
+
+void generateAngles(const Options& opts, const int worldRank, double *angles, const size_t numAngles)
+{
+	if (opts.stats != nullptr)
+		opts.stats->generated += static_cast<long long>(numAngles);
+
+	size_t numBlocks = (numAngles + GENERATE_BLOCK - 1) / GENERATE_BLOCK;
+	auto fill = [&opts, worldRank, numAngles, angles](size_t firstBlock, size_t lastBlock)
+	{
+		for (size_t b = firstBlock; b < lastBlock; b++)
+		{
+			Xoshiro256 rng(opts.seed, worldRank, STREAM_ANGLES, b);
+			size_t end = std::min(numAngles, (b + 1) * GENERATE_BLOCK);
+			for (size_t i = b * GENERATE_BLOCK; i < end; i++)
+				angles[i] = rng.uniform(opts.angleMin, opts.angleMax);
+		}
+	};
+
+	if ((opts.pool == nullptr) || (opts.pool->size() == 1) || (numBlocks < 2))
+		fill(0, numBlocks);
+	else
+		opts.pool->parallelFor(numBlocks, false, fill);
+}
+
+void generateAngles(const Options& opts, const int worldSize, const int worldRank, ArenaVector<double>& angles)
+{
+	//! Fill a vector sized once
+	angles.resize(static_cast<size_t>(generatedCount(opts, worldSize, worldRank)));
+	generateAngles(opts, worldRank, angles.data(), angles.size());
+}
+
+void printVector(const Options& opts, const char *label, const ArenaVector<double>& vec)
+{
+	if (opts.verbosity < VERBOSITY_DEBUG)
+		return;
+
+	std::ostringstream out;
+	out << label << " (" << vec.size() << "): ";
+	for (size_t i = 0; i < vec.size(); i++)
+		out << vec[i] << " ";
+	out << "\n";
+	std::cout << out.str() << std::endl;
+}
+
+void reportSines(const Options& opts, const int worldRank, const double *angles, const double *sines, const size_t n)
+{
+	if (opts.verbosity < VERBOSITY_DEBUG)
+		return;
+
+	std::ostringstream out;
+	if (worldRank == MASTER)
+		out << "Balanced vector kept by master (" << n << "): ";
+	else
+		out << "Received vector by slave " << worldRank << " (" << n << "): ";
+	for (size_t j = 0; j < n; j++)
+		out << angles[j] << "->(" << sines[j] << ") ";
+	out << "\n";
+	std::cout << out.str() << std::endl;
+}
+
+void reportReturned(const Options& opts, const int worldRank, const ArenaVector<double>& angles,
+					const ArenaVector<double>& sines)
+{
+	if (opts.verbosity < VERBOSITY_DEBUG)
+		return;
+
+	std::ostringstream out;
+	out << "Returned to rank " << worldRank << " (" << sines.size() << "): ";
+	for (size_t j = 0; j < sines.size(); j++)
+		out << angles[j] << "->(" << sines[j] << ") ";
+	out << "\n";
+	std::cout << out.str() << std::endl;
+}
+
+void computeSine(const Options& opts, const int worldRank, ArenaVector<double>& vec)
+{
+	//! Run the batch kernel over the whole contiguous vector before any output
+	ArenaVector<double> sines(vec.size());
+	runKernel(opts, vec.data(), sines.data(), vec.size());
+	reportSines(opts, worldRank, vec.data(), sines.data(), vec.size());
+
+	vec.swap(sines);
+}
+
+bool masterReads(const Options& opts, const int worldSize)
+{
+	return opts.masterComputes
+		   && ((worldSize == 1) || (opts.mode == Mode::DECENTRALIZED) || (opts.mode == Mode::STEAL)
+			   || (opts.mode == Mode::STREAM) || (opts.mode == Mode::HIERARCHICAL) || (opts.mode == Mode::DIFFUSION));
+}
+
+void readWindow(const Options& opts, const int worldSize, const int worldRank, const long long begin,
+				const long long count, double *angles, MPI_Request *request)
+{
+	std::vector<long long> counts = balancedCounts(count, worldSize, masterReads(opts, worldSize));
+	std::vector<long long> displs = displacements(counts);
+
+	double t = MPI_Wtime();
+	LargeCount large(counts[worldRank], MPI_DOUBLE);
+	MPI_File_iread_at_all(opts.input, static_cast<MPI_Offset>(begin + displs[worldRank]) * sizeof(double),
+						  angles, large.count(), large.type(), request);
+	endPhase(opts, PHASE_IO, t);
+
+	if (opts.stats != nullptr)
+		opts.stats->generated += counts[worldRank];
+}
+
+void readWindow(const Options& opts, const int worldSize, const int worldRank, const long long begin,
+				const long long count, ArenaVector<double>& angles, MPI_Request *request)
+{
+	angles.resize(static_cast<size_t>(balancedCounts(count, worldSize, masterReads(opts, worldSize))[worldRank]));
+	readWindow(opts, worldSize, worldRank, begin, count, angles.data(), request);
+}
+
+void readAngles(const Options& opts, const int worldSize, const int worldRank, ArenaVector<double>& angles)
+{
+	angles.resize(static_cast<size_t>(angleCount(opts, worldSize, worldRank)));
+	loadAngles(opts, worldSize, worldRank, angles.data(), static_cast<long long>(angles.size()));
+}
+
+long long angleCount(const Options& opts, const int worldSize, const int worldRank)
+{
+	if (opts.input != MPI_FILE_NULL)
+		return balancedCounts(opts.inputSize, worldSize, masterReads(opts, worldSize))[worldRank];
+	if (worldRank == MASTER)
+		return 0;
+
+	return generatedCount(opts, worldSize, worldRank);
+}
+
+void loadAngles(const Options& opts, const int worldSize, const int worldRank, double *angles, const long long count)
+{
+	if (opts.input != MPI_FILE_NULL)
+	{
+		MPI_Request request;
+		readWindow(opts, worldSize, worldRank, 0, opts.inputSize, angles, &request);
+
+		double t = MPI_Wtime();
+		MPI_Wait(&request, MPI_STATUS_IGNORE);
+		endPhase(opts, PHASE_IO, t);
+	}
+	else if (worldRank != MASTER)
+		generateAngles(opts, worldRank, angles, static_cast<size_t>(count));
+}
+
+void loadAngles(const Options& opts, const int worldSize, const int worldRank, ArenaVector<double>& angles)
+{
+	if (opts.input != MPI_FILE_NULL)
+		readAngles(opts, worldSize, worldRank, angles);
+	else if (worldRank != MASTER)
+		generateAngles(opts, worldSize, worldRank, angles);
+}
+
+void writeResults(const Options& opts, const long long offset, const double *results, const long long count)
+{
+	if (opts.output == MPI_FILE_NULL)
+		return;
+
+	double t = MPI_Wtime();
+	LargeCount large(count, MPI_DOUBLE);
+	MPI_File_write_at_all(opts.output, static_cast<MPI_Offset>(offset) * sizeof(double), results, large.count(),
+						  large.type(), MPI_STATUS_IGNORE);
+	endPhase(opts, PHASE_IO, t);
+}
+
+void writeResults(const Options& opts, const long long offset, const ArenaVector<double>& results)
+{
+	writeResults(opts, offset, results.data(), static_cast<long long>(results.size()));
+}
+
+void finishResults(const Options& opts, const int worldRank, double *results, const long long count,
+				   const long long offset)
+{
+	writeResults(opts, offset, results, count);
+	if (!opts.keepResults)
+		return;
+
+	double t = MPI_Wtime();
+	DistributedResults kept(opts, results, count, offset);
+	double sum = kept.reduce(MPI_SUM);
+	double min = kept.reduce(MPI_MIN);
+	double max = kept.reduce(MPI_MAX);
+	if ((worldRank == MASTER) && (opts.verbosity >= VERBOSITY_SUMMARY) && !opts.bench)
+	{
+		std::cout << "Kept results: " << kept.size() << " values, sum = " << sum << ", min = " << min
+				  << ", max = " << max << std::endl;
+
+		if (opts.verbosity >= VERBOSITY_DEBUG)
+		{
+			ArenaVector<double> sample(static_cast<size_t>(std::min(KEPT_SAMPLE, kept.size())));
+			kept.fetch(0, static_cast<long long>(sample.size()), sample.data());
+			printVector(opts, "First kept results", sample);
+		}
+	}
+	endPhase(opts, PHASE_RESULTS, t);
+}
+
+void finishResults(const Options& opts, const int worldRank, ArenaVector<double>& results, const long long offset)
+{
+	finishResults(opts, worldRank, results.data(), static_cast<long long>(results.size()), offset);
+}
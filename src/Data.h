@@ -0,0 +1,263 @@
+/**
+* @file This file is part of LoadBalance.
+*
+* @section LICENSE
+* MIT License
+*
+* Copyright (c) 2018 Rajdeep Konwar
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*
+* @section DESCRIPTION
+* Generating, reading, reporting and writing angles and sine values
+**/
+
+#ifndef LOADBALANCE_DATA_H
+#define LOADBALANCE_DATA_H
+
+#include <iostream>
+#include <numeric>
+#include <sstream>
+
+#include "Partition.h"
+
+//! Independent random streams of a rank
+const uint64_t STREAM_COUNT = 0;	//!< Number of angles
+const uint64_t STREAM_ANGLES = 1;	//!< Angles, one stream per block of GENERATE_BLOCK
+const uint64_t STREAM_STEAL = 2;	//!< Victim selection
+const uint64_t STREAM_DRIFT = 3;	//!< Per-timestep change of a rank's angles, one stream per timestep
+
+//! Angles per generation stream, so the input does not depend on the number of generating threads
+const size_t GENERATE_BLOCK = 65536;
+
+//! xoshiro256** generator. Each (seed, rank, purpose, block) gets its own stream by running the combination
+//! through splitmix64, so threads and ranks never share state.
+class Xoshiro256
+{
+public:
+	Xoshiro256(const uint64_t seed, const int rank, const uint64_t purpose, const uint64_t block = 0)
+	{
+		uint64_t x = seed ^ (static_cast<uint64_t>(rank) << 44) ^ (purpose << 40) ^ block;
+		for (int i = 0; i < 4; i++)
+		{
+			x += 0x9e3779b97f4a7c15ULL;
+			uint64_t z = x;
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+			m_s[i] = z ^ (z >> 31);
+		}
+	}
+
+	uint64_t next()
+	{
+		uint64_t result = rotl(m_s[1] * 5, 7) * 9;
+		uint64_t t = m_s[1] << 17;
+		m_s[2] ^= m_s[0];
+		m_s[3] ^= m_s[1];
+		m_s[1] ^= m_s[2];
+		m_s[0] ^= m_s[3];
+		m_s[2] ^= t;
+		m_s[3] = rotl(m_s[3], 45);
+
+		return result;
+	}
+
+	//! Uniform in [low, high) from the top 53 bits
+	double uniform(const double low, const double high)
+	{
+		return low + (high - low) * (static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0));
+	}
+
+	//! Uniform in [low, high]
+	long long uniformInt(const long long low, const long long high)
+	{
+		return low + static_cast<long long>(next() % static_cast<uint64_t>(high - low + 1));
+	}
+
+private:
+	static uint64_t rotl(const uint64_t x, const int k)
+	{
+		return (x << k) | (x >> (64 - k));
+	}
+
+	uint64_t m_s[4];
+};
+
+//! Number of angles each generating rank (slaves 1 to N-1) produces for a strong or weak scaling input. Shares
+//! follow the distribution, and prefix sums of the shares are rounded so the counts add up to the exact total.
+std::vector<long long> generatedCounts(const Options& opts, const int worldSize);
+
+//! Number of angles slave worldRank generates: its entry of generatedCounts, or a random count
+long long generatedCount(const Options& opts, const int worldSize, const int worldRank);
+
+//! Fill a slave's vector with random angles, as many as the scaling option asks for. Every block of
+//! GENERATE_BLOCK angles has its own stream, so blocks are filled in parallel on the rank's compute threads.
+void generateAngles(const Options& opts, const int worldSize, const int worldRank, ArenaVector<double>& angles);
+
+//! Fill generatedCount(...) angles of a slave into memory the caller owns
+void generateAngles(const Options& opts, const int worldRank, double *angles, const size_t numAngles);
+
+//! Print a labelled vector on a single line in one buffered write (debug verbosity only)
+void printVector(const Options& opts, const char *label, const ArenaVector<double>& vec);
+
+//! Print the angles a rank computed next to their sine values, after the kernel has run and in one buffered
+//! write (debug verbosity only)
+void reportSines(const Options& opts, const int worldRank, const double *angles, const double *sines, const size_t n);
+
+//! Print a rank's own angles next to the sine values returned to it (debug verbosity only)
+void reportReturned(const Options& opts, const int worldRank, const ArenaVector<double>& angles,
+					const ArenaVector<double>& sines);
+
+//! Calculate sin(x) in-place over a rank's balanced vector
+void computeSine(const Options& opts, const int worldRank, ArenaVector<double>& vec);
+
+//! Modes without a master rebalance among whichever ranks hold the input, so the master reads a share too if
+//! it computes; the other modes collect the input on the master and read it on the slaves only, unless the
+//! master is the only rank
+bool masterReads(const Options& opts, const int worldSize);
+
+//! Start reading this rank's contiguous, count-balanced share of the input angles [begin, begin + count) with
+//! one non-blocking collective read, so the input is balanced as it is read instead of being shuffled through
+//! one rank
+void readWindow(const Options& opts, const int worldSize, const int worldRank, const long long begin,
+				const long long count, ArenaVector<double>& angles, MPI_Request *request);
+
+//! Start reading into angles, which has room for this rank's share of the window
+void readWindow(const Options& opts, const int worldSize, const int worldRank, const long long begin,
+				const long long count, double *angles, MPI_Request *request);
+
+//! Read this rank's share of the whole input file
+void readAngles(const Options& opts, const int worldSize, const int worldRank, ArenaVector<double>& angles);
+
+//! This rank's angles: its range of the input file, or generated ones on the slaves. Called on every rank,
+//! since reading is collective.
+void loadAngles(const Options& opts, const int worldSize, const int worldRank, ArenaVector<double>& angles);
+
+//! Number of angles loadAngles gives this rank, known before any is read or generated
+long long angleCount(const Options& opts, const int worldSize, const int worldRank);
+
+//! Load this rank's count = angleCount(...) angles into memory the caller owns, e.g. a shared window
+void loadAngles(const Options& opts, const int worldSize, const int worldRank, double *angles, const long long count);
+
+//! Write count sine values of this rank at a global element offset of the output file with one collective
+//! write. Called on every rank; ranks without results write nothing.
+void writeResults(const Options& opts, const long long offset, const double *results, const long long count);
+
+void writeResults(const Options& opts, const long long offset, const ArenaVector<double>& results);
+
+//! Sine values left on the ranks that computed them, as contiguous ranges of the global order. Construction is
+//! collective: every rank's range start is replicated with one allgather, so the owner of any global index is
+//! a binary search away, and the values are exposed in a window that any rank reads without the owner's help.
+class DistributedResults
+{
+public:
+	DistributedResults(const Options& opts, double *values, const long long count, const long long offset,
+					   const MPI_Comm comm = MPI_COMM_WORLD)
+		: m_opts(opts), m_values(values), m_count(count), m_comm(comm), m_win(MPI_WIN_NULL)
+	{
+		int size;
+		MPI_Comm_size(comm, &size);
+		m_starts.resize(static_cast<size_t>(size) + 1);
+		MPI_Allgather(&offset, 1, MPI_LONG_LONG, m_starts.data(), 1, MPI_LONG_LONG, comm);
+		long long total = 0;
+		MPI_Allreduce(&count, &total, 1, MPI_LONG_LONG, MPI_SUM, comm);
+		m_starts[size] = total;
+
+		MPI_Win_create(values, static_cast<MPI_Aint>(count * sizeof(double)), sizeof(double), MPI_INFO_NULL,
+					   comm, &m_win);
+		MPI_Win_lock_all(MPI_MODE_NOCHECK, m_win);
+	}
+
+	~DistributedResults()
+	{
+		MPI_Win_unlock_all(m_win);
+		MPI_Win_free(&m_win);
+	}
+
+	DistributedResults(const DistributedResults&) = delete;
+	DistributedResults& operator=(const DistributedResults&) = delete;
+
+	//! Number of values across all ranks
+	long long size() const { return m_starts.back(); }
+
+	//! Rank holding the value at a global index in [0, size())
+	int owner(const long long index) const
+	{
+		return static_cast<int>(std::upper_bound(m_starts.begin(), m_starts.end() - 1, index) - m_starts.begin()) - 1;
+	}
+
+	//! Copy count values from global index begin into out with one MPI_Get per owner. Not collective.
+	void fetch(const long long begin, const long long count, double *out) const
+	{
+		long long end = begin + count;
+		for (long long index = begin; index < end; )
+		{
+			int rank = owner(index);
+			long long n = std::min(end, m_starts[rank + 1]) - index;
+			LargeCount large(n, MPI_DOUBLE);
+			MPI_Get(out + (index - begin), large.count(), large.type(), rank, index - m_starts[rank], large.count(),
+					large.type(), m_win);
+			MPI_Win_flush(rank, m_win);
+			countBytes(m_opts, 0, typeBytes(n, MPI_DOUBLE));
+			index += n;
+		}
+	}
+
+	//! Reduce all values with MPI_SUM, MPI_PROD, MPI_MIN or MPI_MAX; the result is returned on every rank.
+	//! Collective. Each rank reduces its own range first, so a single value per rank crosses the network.
+	double reduce(const MPI_Op op) const
+	{
+		double value;
+		if (op == MPI_SUM)
+			value = std::accumulate(m_values, m_values + m_count, 0.0);
+		else if (op == MPI_PROD)
+			value = std::accumulate(m_values, m_values + m_count, 1.0, std::multiplies<double>());
+		else if (op == MPI_MIN)
+			value = std::accumulate(m_values, m_values + m_count, std::numeric_limits<double>::infinity(),
+									[](const double a, const double b) { return std::min(a, b); });
+		else
+			value = std::accumulate(m_values, m_values + m_count, -std::numeric_limits<double>::infinity(),
+									[](const double a, const double b) { return std::max(a, b); });
+
+		double result;
+		MPI_Allreduce(&value, &result, 1, MPI_DOUBLE, op, m_comm);
+		return result;
+	}
+
+private:
+	const Options& m_opts;
+	double *m_values;					//!< This rank's range
+	long long m_count;
+	std::vector<long long> m_starts;	//!< Global index of every rank's first value, then the total
+	MPI_Comm m_comm;
+	MPI_Win m_win;
+};
+
+//! Values the master fetches back from their owners to show kept results at debug verbosity
+const long long KEPT_SAMPLE = 8;
+
+//! Write a rank's results at its global offset and, with --keep-results, leave them on the rank that computed
+//! them: the summary aggregates are reduced in place and nothing is gathered on the master.
+void finishResults(const Options& opts, const int worldRank, double *results, const long long count,
+				   const long long offset);
+
+void finishResults(const Options& opts, const int worldRank, ArenaVector<double>& results, const long long offset);
+
+#endif
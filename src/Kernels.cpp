@@ -0,0 +1,264 @@
+/**
+* @file This file is part of LoadBalance.
+*
+* @section LICENSE
+* MIT License
+*
+* Copyright (c) 2018 Rajdeep Konwar
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*
+* @section DESCRIPTION
+* Batch sine kernels: libm, polynomial (scalar, AVX2, AVX-512, NEON) and lookup table
+**/
+
+#include "Kernels.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+//! pi/2 split into two 33-bit parts and a tail (Cody-Waite), and 2/pi
+const double PIO2_1 = 1.57079632673412561417e+00;
+const double PIO2_2 = 6.07710050630396597660e-11;
+const double PIO2_3 = 2.02226624879595063154e-21;
+const double TWO_OVER_PI = 6.36619772367581382433e-01;
+
+//! Minimax coefficients of sin(r) = r + r^3 S(r^2) and cos(r) = 1 - r^2/2 + r^4 C(r^2) on [-pi/4, pi/4]
+const double SIN_C[] = {1.58962301576546568060e-10, -2.50507477628578072866e-8, 2.75573136213857245213e-6,
+						-1.98412698295895385996e-4, 8.33333333332211858878e-3, -1.66666666666666307295e-1};
+const double COS_C[] = {-1.13585365213876817300e-11, 2.08757008419747316778e-9, -2.75573141792967388112e-7,
+						2.48015872888517045348e-5, -1.38888888888730564116e-3, 4.16666666666665929218e-2};
+
+void sineLibm(const double *in, double *out, const size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+		out[i] = std::sin(in[i]);
+}
+
+void sineScalar(const double *in, double *out, const size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		double x = in[i];
+		if (!(std::fabs(x) <= SINE_MAX_ARG))
+		{
+			out[i] = std::sin(x);
+			continue;
+		}
+
+		double q = std::nearbyint(x * TWO_OVER_PI);
+		double r = ((x - q * PIO2_1) - q * PIO2_2) - q * PIO2_3;
+		double z = r * r;
+
+		double s = SIN_C[0];
+		double c = COS_C[0];
+		for (int k = 1; k < 6; k++)
+		{
+			s = s * z + SIN_C[k];
+			c = c * z + COS_C[k];
+		}
+		s = r + r * z * s;
+		c = 1.0 - 0.5 * z + z * z * c;
+
+		long quadrant = static_cast<long>(q);
+		double v = (quadrant & 1) ? c : s;
+		out[i] = (quadrant & 2) ? -v : v;
+	}
+}
+
+#if defined(__GNUC__) && defined(__x86_64__)
+
+__attribute__((target("avx2,fma")))
+void sineAvx2(const double *in, double *out, const size_t n)
+{
+	const __m256d maxArg = _mm256_set1_pd(SINE_MAX_ARG);
+	const __m256d absMask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffLL));
+	const __m256d shifter = _mm256_set1_pd(6755399441055744.0);
+	const __m256i one = _mm256_set1_epi64x(1);
+	const __m256i two = _mm256_set1_epi64x(2);
+
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		__m256d x = _mm256_loadu_pd(in + i);
+
+		//! Round x * 2/pi to the nearest integer; adding 1.5 * 2^52 leaves it in the low mantissa bits
+		__m256d q = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(TWO_OVER_PI)),
+									_MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+		__m256i quadrant = _mm256_castpd_si256(_mm256_add_pd(q, shifter));
+
+		__m256d r = _mm256_fnmadd_pd(q, _mm256_set1_pd(PIO2_1), x);
+		r = _mm256_fnmadd_pd(q, _mm256_set1_pd(PIO2_2), r);
+		r = _mm256_fnmadd_pd(q, _mm256_set1_pd(PIO2_3), r);
+		__m256d z = _mm256_mul_pd(r, r);
+
+		__m256d s = _mm256_set1_pd(SIN_C[0]);
+		__m256d c = _mm256_set1_pd(COS_C[0]);
+		for (int k = 1; k < 6; k++)
+		{
+			s = _mm256_fmadd_pd(s, z, _mm256_set1_pd(SIN_C[k]));
+			c = _mm256_fmadd_pd(c, z, _mm256_set1_pd(COS_C[k]));
+		}
+		s = _mm256_fmadd_pd(_mm256_mul_pd(r, z), s, r);
+		c = _mm256_fmadd_pd(_mm256_mul_pd(z, z), c, _mm256_fnmadd_pd(_mm256_set1_pd(0.5), z, _mm256_set1_pd(1.0)));
+
+		//! Odd quadrants take the cosine, quadrants 2 and 3 flip the sign
+		__m256d useCos = _mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(quadrant, one), one));
+		__m256d sign = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_and_si256(quadrant, two), 62));
+		__m256d v = _mm256_xor_pd(_mm256_blendv_pd(s, c, useCos), sign);
+		_mm256_storeu_pd(out + i, v);
+
+		//! Lanes outside the reduced range (including NaN/inf) go through libm
+		int outside = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_and_pd(x, absMask), maxArg, _CMP_NLE_UQ));
+		if (outside)
+			for (int lane = 0; lane < 4; lane++)
+				if (outside & (1 << lane))
+					out[i + lane] = std::sin(in[i + lane]);
+	}
+	sineScalar(in + i, out + i, n - i);
+}
+
+__attribute__((target("avx512f")))
+void sineAvx512(const double *in, double *out, const size_t n)
+{
+	const __m512d maxArg = _mm512_set1_pd(SINE_MAX_ARG);
+	const __m512d shifter = _mm512_set1_pd(6755399441055744.0);
+	const __m512i one = _mm512_set1_epi64(1);
+	const __m512i two = _mm512_set1_epi64(2);
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		__m512d x = _mm512_loadu_pd(in + i);
+
+		__m512d q = _mm512_roundscale_pd(_mm512_mul_pd(x, _mm512_set1_pd(TWO_OVER_PI)),
+										 _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+		__m512i quadrant = _mm512_castpd_si512(_mm512_add_pd(q, shifter));
+
+		__m512d r = _mm512_fnmadd_pd(q, _mm512_set1_pd(PIO2_1), x);
+		r = _mm512_fnmadd_pd(q, _mm512_set1_pd(PIO2_2), r);
+		r = _mm512_fnmadd_pd(q, _mm512_set1_pd(PIO2_3), r);
+		__m512d z = _mm512_mul_pd(r, r);
+
+		__m512d s = _mm512_set1_pd(SIN_C[0]);
+		__m512d c = _mm512_set1_pd(COS_C[0]);
+		for (int k = 1; k < 6; k++)
+		{
+			s = _mm512_fmadd_pd(s, z, _mm512_set1_pd(SIN_C[k]));
+			c = _mm512_fmadd_pd(c, z, _mm512_set1_pd(COS_C[k]));
+		}
+		s = _mm512_fmadd_pd(_mm512_mul_pd(r, z), s, r);
+		c = _mm512_fmadd_pd(_mm512_mul_pd(z, z), c, _mm512_fnmadd_pd(_mm512_set1_pd(0.5), z, _mm512_set1_pd(1.0)));
+
+		__mmask8 useCos = _mm512_test_epi64_mask(quadrant, one);
+		__m512i sign = _mm512_slli_epi64(_mm512_and_si512(quadrant, two), 62);
+		__m512d v = _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(_mm512_mask_blend_pd(useCos, s, c)),
+														 sign));
+		_mm512_storeu_pd(out + i, v);
+
+		__mmask8 outside = _mm512_cmp_pd_mask(_mm512_abs_pd(x), maxArg, _CMP_NLE_UQ);
+		if (outside)
+			for (int lane = 0; lane < 8; lane++)
+				if (outside & (1 << lane))
+					out[i + lane] = std::sin(in[i + lane]);
+	}
+	sineScalar(in + i, out + i, n - i);
+}
+
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+
+void sineNeon(const double *in, double *out, const size_t n)
+{
+	const float64x2_t maxArg = vdupq_n_f64(SINE_MAX_ARG);
+
+	size_t i = 0;
+	for (; i + 2 <= n; i += 2)
+	{
+		float64x2_t x = vld1q_f64(in + i);
+
+		float64x2_t q = vrndnq_f64(vmulq_n_f64(x, TWO_OVER_PI));
+		int64x2_t quadrant = vcvtq_s64_f64(q);
+
+		float64x2_t r = vfmsq_f64(x, q, vdupq_n_f64(PIO2_1));
+		r = vfmsq_f64(r, q, vdupq_n_f64(PIO2_2));
+		r = vfmsq_f64(r, q, vdupq_n_f64(PIO2_3));
+		float64x2_t z = vmulq_f64(r, r);
+
+		float64x2_t s = vdupq_n_f64(SIN_C[0]);
+		float64x2_t c = vdupq_n_f64(COS_C[0]);
+		for (int k = 1; k < 6; k++)
+		{
+			s = vfmaq_f64(vdupq_n_f64(SIN_C[k]), s, z);
+			c = vfmaq_f64(vdupq_n_f64(COS_C[k]), c, z);
+		}
+		s = vfmaq_f64(r, vmulq_f64(r, z), s);
+		c = vfmaq_f64(vfmsq_f64(vdupq_n_f64(1.0), vdupq_n_f64(0.5), z), vmulq_f64(z, z), c);
+
+		uint64x2_t useCos = vtstq_s64(quadrant, vdupq_n_s64(1));
+		uint64x2_t sign = vshlq_n_u64(vandq_u64(vreinterpretq_u64_s64(quadrant), vdupq_n_u64(2)), 62);
+		float64x2_t v = vbslq_f64(useCos, c, s);
+		vst1q_f64(out + i, vreinterpretq_f64_u64(veorq_u64(vreinterpretq_u64_f64(v), sign)));
+
+		uint64x2_t inside = vcleq_f64(vabsq_f64(x), maxArg);
+		if (vgetq_lane_u64(inside, 0) == 0)
+			out[i] = std::sin(in[i]);
+		if (vgetq_lane_u64(inside, 1) == 0)
+			out[i + 1] = std::sin(in[i + 1]);
+	}
+	sineScalar(in + i, out + i, n - i);
+}
+
+#endif
+
+SineKernel bestSineKernel()
+{
+#if defined(__GNUC__) && defined(__x86_64__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f"))
+		return sineAvx512;
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		return sineAvx2;
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+	return sineNeon;
+#endif
+	return sineScalar;
+}
+
+void sineLookup(const double *in, double *out, const size_t n)
+{
+	const SineTable& table = SineTable::instance();
+	for (size_t i = 0; i < n; i++)
+		out[i] = table(in[i]);
+}
+
+double unitCost(const double)
+{
+	return 1.0;
+}
+
+double rangeReductionCost(const double angle)
+{
+	return 1.0 + std::log2(1.0 + std::fabs(angle) / TWO_PI);
+}
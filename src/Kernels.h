@@ -0,0 +1,140 @@
+/**
+* @file This file is part of LoadBalance.
+*
+* @section LICENSE
+* MIT License
+*
+* Copyright (c) 2018 Rajdeep Konwar
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*
+* @section DESCRIPTION
+* Batch sine kernels: libm, polynomial (scalar, AVX2, AVX-512, NEON) and lookup table
+**/
+
+#ifndef LOADBALANCE_KERNELS_H
+#define LOADBALANCE_KERNELS_H
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+const double TWO_PI = 6.283185307179586;
+
+//! Largest |x| handled by the polynomial kernels; larger (and non-finite) arguments fall back to std::sin.
+//! Below it the quadrant is exact in a double and q * PIO2_1, q * PIO2_2 are exact products.
+const double SINE_MAX_ARG = 1.0e6;
+
+//! Batch kernel computing out[i] = sin(in[i]) over contiguous arrays. The polynomial kernels (scalar, AVX2,
+//! AVX-512, NEON) reduce by pi/2 and evaluate degree-13/14 minimax polynomials; against a long double
+//! reference their maximum error is 1.6 ulp for |x| <= 360 and 2.4 ulp up to SINE_MAX_ARG (sin(-0) gives +0).
+typedef void (*SineKernel)(const double *, double *, size_t);
+
+//! Reference kernel: one libm call per element
+void sineLibm(const double *in, double *out, const size_t n);
+
+//! Scalar version of the polynomial kernel, also used for the tails of the vector kernels
+void sineScalar(const double *in, double *out, const size_t n);
+
+#if defined(__GNUC__) && defined(__x86_64__)
+
+//! AVX2/FMA kernel, 4 doubles per iteration
+__attribute__((target("avx2,fma")))
+void sineAvx2(const double *in, double *out, const size_t n);
+
+//! AVX-512 kernel, 8 doubles per iteration
+__attribute__((target("avx512f")))
+void sineAvx512(const double *in, double *out, const size_t n);
+
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+
+//! NEON kernel, 2 doubles per iteration
+void sineNeon(const double *in, double *out, const size_t n);
+
+#endif
+
+//! Fastest kernel this CPU supports
+SineKernel bestSineKernel();
+
+//! Default error bound of the lookup-table kernel
+const double LUT_ERROR = 1.0e-7;
+
+//! sin over one period, sampled for the lookup-table kernel. Linear interpolation between nodes h apart is off
+//! by at most h^2/8, as |sin''| <= 1, so the spacing follows from the error bound. The default bound needs
+//! 7027 nodes (about 55 KiB): more than a typical 32-48 KiB L1 data cache, but resident in L2 while a batch is
+//! computed. Bounds of 1e-6 and looser fit in L1.
+class SineTable
+{
+public:
+	static SineTable& instance()
+	{
+		static SineTable table;
+		return table;
+	}
+
+	void build(const double maxError)
+	{
+		m_intervals = std::ceil(TWO_PI / std::sqrt(8.0 * maxError));
+		m_scale = m_intervals / TWO_PI;
+
+		//! One node past the period so the last interval (and a rounded-up index) interpolates in bounds
+		size_t nodes = static_cast<size_t>(m_intervals) + 2;
+		m_values.resize(nodes);
+		for (size_t i = 0; i < nodes; i++)
+			m_values[i] = std::sin(static_cast<double>(i) * TWO_PI / m_intervals);
+	}
+
+	double operator()(const double x) const
+	{
+		if (!(std::fabs(x) <= SINE_MAX_ARG))
+			return std::sin(x);
+
+		double t = x * m_scale;
+		t -= std::floor(t / m_intervals) * m_intervals;
+		size_t i = static_cast<size_t>(t);
+		double frac = t - static_cast<double>(i);
+		return m_values[i] + frac * (m_values[i + 1] - m_values[i]);
+	}
+
+	size_t size() const
+	{
+		return m_values.size();
+	}
+
+private:
+	double m_intervals = 0.0, m_scale = 0.0;
+	std::vector<double> m_values;
+};
+
+//! Lookup-table kernel: linear interpolation in the per-rank SineTable, within its error bound
+void sineLookup(const double *in, double *out, const size_t n);
+
+//! Estimated relative cost of computing one element
+typedef double (*CostModel)(double);
+
+//! Every angle costs the same
+double unitCost(const double);
+
+//! Range reduction of sin(x) gets more expensive with the magnitude of x
+double rangeReductionCost(const double angle);
+
+#endif
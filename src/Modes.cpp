@@ -0,0 +1,2104 @@
+/**
+* @file This file is part of LoadBalance.
+*
+* @section LICENSE
+* MIT License
+*
+* Copyright (c) 2018 Rajdeep Konwar
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*
+* @section DESCRIPTION
+* Redistribution schemes, their summary and the benchmark driver
+**/
+
+#include "Modes.h"
+
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <fstream>
+
+#if defined(LOADBALANCE_GPU)
+#include <omp.h>
+#if defined(OPEN_MPI)
+#include <mpi-ext.h>
+#endif
+#endif
+
+//! Chunks a pipelined worker has in flight towards it at any time
+#define PIPELINE_DEPTH	2
+
+//! Angles a wire-format sine kernel decodes at a time, on the stack
+#define DECODE_BLOCK	256
+
+//! Gather, balance and compute with one message per slave and phase. Messages carry no separate count: the
+//! receiver matches each with MPI_Mprobe and sizes the receive from the envelope. The master services slaves in
+//! arrival order, so a slow slave does not hold up the ones behind it.
+void serialBalance(const Options& opts, const int worldSize, const int worldRank)
+{
+	ArenaVector<double> masterVec, slaveVec, resultVec;
+	std::vector<long long> counts, displs, balanced, balancedDispls;
+
+	loadAngles(opts, worldSize, worldRank, slaveVec);
+	if (worldRank == MASTER)
+	{
+		//! Match every slave's angles as they arrive; their sizes give the offsets in the master vector. The
+		//! master's own angles (read only when it is the single rank) lead.
+		double t = MPI_Wtime();
+		counts.assign(static_cast<size_t>(worldSize), 0);
+		counts[MASTER] = static_cast<long long>(slaveVec.size());
+		std::vector<int> arrival;
+		std::vector<MPI_Message> messages(static_cast<size_t>(worldSize), MPI_MESSAGE_NULL);
+		for (int i = 1; i < worldSize; i++)
+		{
+			MPI_Status status;
+			MPI_Message message;
+			long long count = traceMprobe(opts, MPI_ANY_SOURCE, TAG_ANGLES, MPI_COMM_WORLD, MPI_DOUBLE, &message,
+										  &status);
+			counts[status.MPI_SOURCE] = count;
+			messages[status.MPI_SOURCE] = message;
+			arrival.push_back(status.MPI_SOURCE);
+		}
+		displs = displacements(counts);
+		masterVec.resize(static_cast<size_t>(displs.back() + counts.back()));
+		std::copy(slaveVec.begin(), slaveVec.end(), masterVec.begin());
+		t = endPhase(opts, PHASE_COUNTS, t);
+
+		//! Receive the slave-angles directly into their offsets in the master vector
+		for (size_t k = 0; k < arrival.size(); k++)
+		{
+			int i = arrival[k];
+			traceMrecv(opts, masterVec.data() + displs[i], counts[i], MPI_DOUBLE, &messages[i]);
+		}
+		endPhase(opts, PHASE_GATHER, t);
+
+		if (opts.verbosity >= VERBOSITY_DEBUG)
+		{
+			std::ostringstream out;
+			for (int i = 1; i < worldSize; i++)
+				out << "Received no. of angles = " << counts[i] << " from rank " << i << "\n";
+			std::cout << out.str() << std::endl;
+		}
+		printVector(opts, "Master vector", masterVec);
+
+		ArenaVector<double> weights;
+		if (opts.balance == Balance::WEIGHTED)
+			weights = angleWeights(opts, masterVec);
+		balanced = masterPartition(opts, masterVec, weights, initialCapacity(opts, worldSize));
+		balancedDispls = displacements(balanced);
+
+		//! Send balanced slices to slaves straight from the master vector, without waiting on any one of them
+		t = MPI_Wtime();
+		std::vector<MPI_Request> requests(static_cast<size_t>(worldSize), MPI_REQUEST_NULL);
+		for (int i = 1; i < worldSize; i++)
+			traceIsend(opts, masterVec.data() + balancedDispls[i], balanced[i], MPI_DOUBLE, i, TAG_WORK,
+					   MPI_COMM_WORLD, &requests[i]);
+		endPhase(opts, PHASE_REDISTRIBUTE, t);
+
+		//! Compute master's own leading slice (empty unless it computes) while slaves work on theirs
+		recordHeld(opts, balanced[MASTER]);
+		resultVec.resize(masterVec.size());
+		if (balanced[MASTER] > 0)
+		{
+			size_t own = static_cast<size_t>(balanced[MASTER]);
+			runKernel(opts, masterVec.data(), resultVec.data(), own);
+			reportSines(opts, worldRank, masterVec.data(), resultVec.data(), own);
+		}
+
+		//! Receive sin vectors in the order slaves finish, directly into the offsets their angles came from
+		t = MPI_Wtime();
+		for (int i = 1; i < worldSize; i++)
+		{
+			MPI_Status status;
+			MPI_Message message;
+			long long count = traceMprobe(opts, MPI_ANY_SOURCE, TAG_RESULT, MPI_COMM_WORLD, MPI_DOUBLE, &message,
+										  &status);
+			traceMrecv(opts, resultVec.data() + balancedDispls[status.MPI_SOURCE], count, MPI_DOUBLE, &message);
+		}
+		traceWaitall(opts, worldSize, requests.data(), MPI_STATUSES_IGNORE);
+		endPhase(opts, PHASE_RESULTS, t);
+
+		printVector(opts, "Final Master vector", resultVec);
+	}
+	else
+	{
+		//! Send vector to master; its size travels in the envelope
+		double t = MPI_Wtime();
+		traceSend(opts, slaveVec.data(), static_cast<long long>(slaveVec.size()), MPI_DOUBLE, MASTER, TAG_ANGLES,
+				  MPI_COMM_WORLD);
+		t = endPhase(opts, PHASE_GATHER, t);
+
+		//! Resize slave vector to the matched balanced slice and receive it
+		MPI_Status status;
+		MPI_Message message;
+		long long balancedSize = traceMprobe(opts, MASTER, TAG_WORK, MPI_COMM_WORLD, MPI_DOUBLE, &message, &status);
+		slaveVec.resize(static_cast<size_t>(balancedSize));
+		traceMrecv(opts, slaveVec.data(), balancedSize, MPI_DOUBLE, &message);
+		endPhase(opts, PHASE_REDISTRIBUTE, t);
+		recordHeld(opts, balancedSize);
+
+		computeSine(opts, worldRank, slaveVec);
+
+		//! Send sin vector back to master
+		t = MPI_Wtime();
+		traceSend(opts, slaveVec.data(), balancedSize, MPI_DOUBLE, MASTER, TAG_RESULT, MPI_COMM_WORLD);
+		endPhase(opts, PHASE_RESULTS, t);
+	}
+
+	writeResults(opts, 0, resultVec);
+}
+
+//! Gather, balance and compute using collectives so the MPI library can use tree/pipelined algorithms. Angles
+//! and sine values cross the wire in the format of W.
+template <typename W>
+void collectiveBalance(const Options& opts, const int worldSize, const int worldRank)
+{
+	typedef typename W::Angle Angle;
+	typedef typename W::Sine Sine;
+
+	long long balancedSize = 0;
+	ArenaVector<double> masterVec, slaveVec, resultVec, weights, elapsed;
+	ArenaVector<Angle> masterWire, slaveWire;
+	ArenaVector<Sine> sineWire, resultWire;
+	ArenaVector<double> capacity = initialCapacity(opts, worldSize);
+	std::vector<long long> balanced, balancedDispls, distinctIndex;
+
+	loadAngles(opts, worldSize, worldRank, slaveVec);
+	gatherToMaster(opts, PHASE_COUNTS, PHASE_GATHER, worldSize, worldRank, toWire(slaveVec, slaveWire, W::encodeAngle),
+				   masterWire);
+
+	if (worldRank == MASTER)
+	{
+		fromWire(masterWire, masterVec, W::decodeAngle);
+		printVector(opts, "Master vector", masterVec);
+
+		//! Balance, ship and compute every distinct angle once; results are expanded back after the last pass
+		if (opts.dedupe)
+		{
+			ArenaVector<double> distinct;
+			dedupeValues(masterVec, distinct, distinctIndex);
+			if ((opts.verbosity >= VERBOSITY_SUMMARY) && !opts.bench)
+				std::cout << "Distinct angles = " << distinct.size() << " of " << masterVec.size() << std::endl;
+			masterVec.swap(distinct);
+		}
+
+		weights = angleWeights(opts, masterVec);
+		if (!opts.keepResults)
+			resultWire.resize(masterVec.size());
+		elapsed.resize(static_cast<size_t>(worldSize));
+	}
+	const ArenaVector<Angle>& masterOut = toWire(masterVec, masterWire, W::encodeAngle);
+
+	for (int iter = 0; iter < opts.iterations; iter++)
+	{
+		if (worldRank == MASTER)
+		{
+			balanced = masterPartition(opts, masterVec, weights, capacity);
+			balancedDispls = displacements(balanced);
+		}
+
+		//! Scatter number of balanced angles, then the balanced slices themselves
+		double t = MPI_Wtime();
+		MPI_Scatter(balanced.data(), 1, MPI_LONG_LONG, &balancedSize, 1, MPI_LONG_LONG, MASTER, MPI_COMM_WORLD);
+		t = endPhase(opts, PHASE_COUNTS, t);
+		slaveWire.resize(static_cast<size_t>(balancedSize));
+		traceScatterv(opts, masterOut.data(), balanced.data(), balancedDispls.data(), MpiType<Angle>::get(),
+					  slaveWire.data(), balancedSize, MpiType<Angle>::get(), MASTER, MPI_COMM_WORLD);
+		fromWire(slaveWire, slaveVec, W::decodeAngle);
+		endPhase(opts, PHASE_REDISTRIBUTE, t);
+
+		recordHeld(opts, balancedSize);
+
+		double start = MPI_Wtime();
+		if ((worldRank != MASTER) || (balancedSize > 0))
+			computeSine(opts, worldRank, slaveVec);
+		double computeTime = MPI_Wtime() - start;
+
+		//! Gather sin values back into the same offsets they were scattered from
+		if (!opts.keepResults)
+		{
+			t = MPI_Wtime();
+			const ArenaVector<Sine>& sines = toWire(slaveVec, sineWire, W::encodeSine);
+			traceGatherv(opts, sines.data(), balancedSize, MpiType<Sine>::get(),
+						 resultWire.data(), balanced.data(), balancedDispls.data(), MpiType<Sine>::get(), MASTER,
+						 MPI_COMM_WORLD);
+			endPhase(opts, PHASE_RESULTS, t);
+		}
+
+		//! Feed measured compute times back into the capacities for the next pass
+		if (opts.feedback)
+		{
+			MPI_Gather(&computeTime, 1, MPI_DOUBLE, elapsed.data(), 1, MPI_DOUBLE, MASTER, MPI_COMM_WORLD);
+			if (worldRank == MASTER)
+			{
+				ArenaVector<double> assigned(static_cast<size_t>(worldSize), 0.0);
+				for (int r = 0; r < worldSize; r++)
+					if (opts.balance == Balance::WEIGHTED)
+						for (long long j = balancedDispls[r]; j < balancedDispls[r] + balanced[r]; j++)
+							assigned[r] += weights[j];
+					else
+						assigned[r] = static_cast<double>(balanced[r]);
+				updateCapacity(assigned, elapsed, capacity);
+			}
+		}
+	}
+
+	//! Kept results are the last pass's slices, which lie in rank order
+	if (opts.keepResults)
+	{
+		long long offset = 0;
+		MPI_Exscan(&balancedSize, &offset, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+		finishResults(opts, worldRank, slaveVec, (worldRank == MASTER) ? 0 : offset);
+		return;
+	}
+
+	if (worldRank == MASTER)
+	{
+		fromWire(resultWire, resultVec, W::decodeSine);
+		if (opts.dedupe)
+		{
+			ArenaVector<double> expanded(distinctIndex.size());
+			for (size_t i = 0; i < distinctIndex.size(); i++)
+				expanded[i] = resultVec[distinctIndex[i]];
+			resultVec.swap(expanded);
+		}
+		printVector(opts, "Final Master vector", resultVec);
+	}
+	writeResults(opts, 0, resultVec);
+}
+
+//! Collective balancing in the configured wire format
+void collectiveBalance(const Options& opts, const int worldSize, const int worldRank)
+{
+	if (opts.wire == Wire::FLOAT)
+		collectiveBalance<FloatWire>(opts, worldSize, worldRank);
+	else if (opts.wire == Wire::FIXED16)
+		collectiveBalance<Fixed16Wire>(opts, worldSize, worldRank);
+	else
+		collectiveBalance<DoubleWire>(opts, worldSize, worldRank);
+}
+
+//! Batch sine kernel over angles in the wire format of W, for the decentralized engine: each block is decoded
+//! into a small buffer and handed to the dispatched kernel, which may not run in place
+template <typename W>
+struct WireSineKernel
+{
+	SineKernel sine;
+
+	void operator()(const typename W::Angle *in, double *out, const size_t n) const
+	{
+		double angles[DECODE_BLOCK];
+		for (size_t begin = 0; begin < n; begin += DECODE_BLOCK)
+		{
+			size_t count = std::min(n - begin, static_cast<size_t>(DECODE_BLOCK));
+			for (size_t i = 0; i < count; i++)
+				angles[i] = W::decodeAngle(in[begin + i]);
+			sine(angles, out + begin, count);
+		}
+	}
+};
+
+//! Doubles need no decoding
+template <>
+void WireSineKernel<DoubleWire>::operator()(const double *in, double *out, const size_t n) const
+{
+	sine(in, out, n);
+}
+
+//! Rebalance angles that are contiguous in global order across the ranks and compute the sine of what each
+//! rank receives. Angles cross the wire in the format of W. balancedVec returns this rank's sine values, and the
+//! capacities carry over between calls for feedback. With returned, the last pass's sine values also go back to
+//! the ranks their angles came from, in the order of slaveVec.
+template <typename W>
+void decentralizedPass(const Options& opts, const int worldSize, const int worldRank,
+					   const ArenaVector<double>& slaveVec, ArenaVector<double>& capacity,
+					   ArenaVector<double>& balancedVec, ArenaVector<double> *returned = nullptr)
+{
+	typedef typename W::Angle Angle;
+	typedef typename W::Sine Sine;
+
+	WireSineKernel<W> kernel = {opts.kernel};
+	LoadBalancer<Angle, WireSineKernel<W>, double> balancer(opts, kernel, worldSize, worldRank);
+	ArenaVector<Angle> wire, balancedWire;
+	const ArenaVector<Angle>& local = toWire(slaveVec, wire, W::encodeAngle);
+	ArenaVector<double> weights;
+	if (opts.balance == Balance::WEIGHTED)
+	{
+		weights = angleWeights(opts, slaveVec);
+		balancer.locate(local, &weights);
+	}
+	else
+		balancer.locate(local);
+
+	for (int iter = 0; iter < opts.iterations; iter++)
+	{
+		balancer.distribute(local, capacity, balancedWire);
+
+		//! Work of the received slice, for capacity feedback: its cost, or its size when balancing counts
+		double assignedWeight = static_cast<double>(balancedWire.size());
+		if (opts.feedback && (opts.balance == Balance::WEIGHTED))
+		{
+			assignedWeight = 0.0;
+			for (size_t i = 0; i < balancedWire.size(); i++)
+				assignedWeight += opts.cost(W::decodeAngle(balancedWire[i]));
+		}
+
+		double start = MPI_Wtime();
+		balancer.compute(balancedWire, balancedVec);
+		if ((opts.verbosity >= VERBOSITY_DEBUG) && ((worldRank != MASTER) || !balancedVec.empty()))
+		{
+			ArenaVector<double> angles(balancedWire.size());
+			for (size_t i = 0; i < angles.size(); i++)
+				angles[i] = W::decodeAngle(balancedWire[i]);
+			reportSines(opts, worldRank, angles.data(), balancedVec.data(), balancedVec.size());
+		}
+		double computeTime = MPI_Wtime() - start;
+
+		//! Every rank applies the same capacity update from everyone's measurements
+		if (opts.feedback)
+		{
+			ArenaVector<double> assigned(static_cast<size_t>(worldSize)), elapsed(static_cast<size_t>(worldSize));
+			MPI_Allgather(&assignedWeight, 1, MPI_DOUBLE, assigned.data(), 1, MPI_DOUBLE, MPI_COMM_WORLD);
+			MPI_Allgather(&computeTime, 1, MPI_DOUBLE, elapsed.data(), 1, MPI_DOUBLE, MPI_COMM_WORLD);
+			updateCapacity(assigned, elapsed, capacity);
+		}
+	}
+
+	if (returned != nullptr)
+	{
+		ArenaVector<Sine> sineWire, returnedWire;
+		balancer.returnToOwners(toWire(balancedVec, sineWire, W::encodeSine), returnedWire);
+		fromWire(returnedWire, *returned, W::decodeSine);
+	}
+}
+
+#if defined(LOADBALANCE_GPU)
+//! Device memory of the GPU backend. Allocation goes through OpenMP offloading, so the same code runs on any
+//! device the compiler targets (CUDA, HIP); without one, the host fallback device hands out host memory.
+class DeviceBuffer
+{
+public:
+	explicit DeviceBuffer(const int device) : m_device(device)
+	{
+	}
+
+	~DeviceBuffer()
+	{
+		omp_target_free(m_data, m_device);
+	}
+
+	DeviceBuffer(const DeviceBuffer&) = delete;
+	DeviceBuffer& operator=(const DeviceBuffer&) = delete;
+
+	//! Make room for count doubles; the memory is only reallocated when it grows
+	void reserve(const long long count)
+	{
+		if (count <= m_capacity)
+			return;
+
+		omp_target_free(m_data, m_device);
+		m_capacity = count;
+		m_data = static_cast<double *>(omp_target_alloc(static_cast<size_t>(count) * sizeof(double), m_device));
+	}
+
+	double *data() const
+	{
+		return m_data;
+	}
+
+private:
+	int m_device;
+	double *m_data = nullptr;
+	long long m_capacity = 0;
+};
+
+//! Whether MPI reads and writes memory of the device directly. Memory of the host fallback device always
+//! qualifies.
+bool deviceAwareMpi(const int device)
+{
+	if (device == omp_get_initial_device())
+		return true;
+#if defined(MPIX_CUDA_AWARE_SUPPORT) && MPIX_CUDA_AWARE_SUPPORT
+	if (MPIX_Query_cuda_support() == 1)
+		return true;
+#endif
+#if defined(MPIX_ROCM_AWARE_SUPPORT) && MPIX_ROCM_AWARE_SUPPORT
+	if (MPIX_Query_rocm_support() == 1)
+		return true;
+#endif
+	return false;
+}
+
+//! Copy count doubles between host and device memory
+void deviceCopy(double *dst, const int dstDevice, const double *src, const int srcDevice, const long long count)
+{
+	omp_target_memcpy(dst, const_cast<double *>(src), static_cast<size_t>(count) * sizeof(double), 0, 0, dstDevice,
+					  srcDevice);
+}
+
+//! out[i] = sin(in[i]) over device arrays, on the device
+void sineDevice(const double *in, double *out, const long long n, const int device)
+{
+#pragma omp target teams distribute parallel for is_device_ptr(in, out) device(device)
+	for (long long i = 0; i < n; i++)
+		out[i] = sin(in[i]);
+}
+
+//! Decentralized pass of the GPU backend. With device-aware MPI the balanced slice is received straight into
+//! device memory and the sine values leave from there, back to their owners with returned; otherwise both are
+//! staged through balancedVec. balancedVec returns this rank's sine values when they stay here.
+void devicePass(const Options& opts, const int worldSize, const int worldRank, const ArenaVector<double>& slaveVec,
+				ArenaVector<double>& capacity, ArenaVector<double>& balancedVec, ArenaVector<double> *returned)
+{
+	int device = omp_get_default_device(), host = omp_get_initial_device();
+	bool direct = deviceAwareMpi(device);
+
+	LoadBalancer<double, SineKernel> balancer(opts, opts.kernel, worldSize, worldRank);
+	ArenaVector<double> weights;
+	if (opts.balance == Balance::WEIGHTED)
+	{
+		weights = angleWeights(opts, slaveVec);
+		balancer.locate(slaveVec, &weights);
+	}
+	else
+		balancer.locate(slaveVec);
+
+	DeviceBuffer angles(device), sines(device);
+	long long held = 0;
+	for (int iter = 0; iter < opts.iterations; iter++)
+	{
+		held = balancer.plan(capacity);
+		angles.reserve(held);
+		sines.reserve(held);
+		balancedVec.resize(static_cast<size_t>(held));
+		if (direct)
+			balancer.exchange(slaveVec.data(), angles.data());
+		else
+		{
+			balancer.exchange(slaveVec.data(), balancedVec.data());
+			deviceCopy(angles.data(), device, balancedVec.data(), host, held);
+		}
+
+		//! Cost of the received slice, for weighted capacity feedback, needs the angles on the host
+		double assignedWeight = static_cast<double>(held);
+		if (opts.feedback && (opts.balance == Balance::WEIGHTED))
+		{
+			assignedWeight = 0.0;
+			if (direct)
+				deviceCopy(balancedVec.data(), host, angles.data(), device, held);
+			for (size_t i = 0; i < balancedVec.size(); i++)
+				assignedWeight += opts.cost(balancedVec[i]);
+		}
+
+		double start = MPI_Wtime();
+		sineDevice(angles.data(), sines.data(), held, device);
+		double computeTime = MPI_Wtime() - start;
+		if (opts.stats != nullptr)
+		{
+			opts.stats->computed += held;
+			opts.stats->phaseTime[PHASE_COMPUTE] += computeTime;
+		}
+
+		if (opts.feedback)
+		{
+			ArenaVector<double> assigned(static_cast<size_t>(worldSize)), elapsed(static_cast<size_t>(worldSize));
+			MPI_Allgather(&assignedWeight, 1, MPI_DOUBLE, assigned.data(), 1, MPI_DOUBLE, MPI_COMM_WORLD);
+			MPI_Allgather(&computeTime, 1, MPI_DOUBLE, elapsed.data(), 1, MPI_DOUBLE, MPI_COMM_WORLD);
+			updateCapacity(assigned, elapsed, capacity);
+		}
+	}
+
+	if (opts.verbosity >= VERBOSITY_DEBUG)
+	{
+		ArenaVector<double> hostAngles(static_cast<size_t>(held));
+		deviceCopy(hostAngles.data(), host, angles.data(), device, held);
+		deviceCopy(balancedVec.data(), host, sines.data(), device, held);
+		reportSines(opts, worldRank, hostAngles.data(), balancedVec.data(), static_cast<size_t>(held));
+	}
+
+	if (returned != nullptr)
+	{
+		returned->resize(slaveVec.size());
+		if (direct)
+			balancer.returnToOwners(sines.data(), returned->data());
+		else
+		{
+			deviceCopy(balancedVec.data(), host, sines.data(), device, held);
+			balancer.returnToOwners(balancedVec.data(), returned->data());
+		}
+	}
+	else
+		deviceCopy(balancedVec.data(), host, sines.data(), device, held);
+}
+#endif
+
+//! Decentralized pass in the configured wire format
+void decentralizedPass(const Options& opts, const int worldSize, const int worldRank,
+					   const ArenaVector<double>& slaveVec, ArenaVector<double>& capacity,
+					   ArenaVector<double>& balancedVec, ArenaVector<double> *returned = nullptr)
+{
+#if defined(LOADBALANCE_GPU)
+	if (opts.backend == Backend::GPU)
+	{
+		devicePass(opts, worldSize, worldRank, slaveVec, capacity, balancedVec, returned);
+		return;
+	}
+#endif
+	if (opts.wire == Wire::FLOAT)
+		decentralizedPass<FloatWire>(opts, worldSize, worldRank, slaveVec, capacity, balancedVec, returned);
+	else if (opts.wire == Wire::FIXED16)
+		decentralizedPass<Fixed16Wire>(opts, worldSize, worldRank, slaveVec, capacity, balancedVec, returned);
+	else
+		decentralizedPass<DoubleWire>(opts, worldSize, worldRank, slaveVec, capacity, balancedVec, returned);
+}
+
+//! Balance without a master: each rank ships the parts of its angles that other ranks own
+void decentralizedBalance(const Options& opts, const int worldSize, const int worldRank)
+{
+	ArenaVector<double> slaveVec, balancedVec;
+	ArenaVector<double> capacity = initialCapacity(opts, worldSize);
+
+	loadAngles(opts, worldSize, worldRank, slaveVec);
+	if (opts.returnResults)
+	{
+		//! Every rank ends up with the sine values of its own angles, which are contiguous in global order too
+		ArenaVector<double> returned;
+		decentralizedPass(opts, worldSize, worldRank, slaveVec, capacity, balancedVec, &returned);
+		reportReturned(opts, worldRank, slaveVec, returned);
+
+		long long count = static_cast<long long>(slaveVec.size()), offset = 0;
+		MPI_Exscan(&count, &offset, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+		finishResults(opts, worldRank, returned, (worldRank == MASTER) ? 0 : offset);
+		return;
+	}
+	decentralizedPass(opts, worldSize, worldRank, slaveVec, capacity, balancedVec);
+
+	//! Balanced slices are contiguous in global order, so every rank writes its own at its global offset
+	long long held = static_cast<long long>(balancedVec.size()), heldOffset = 0;
+	MPI_Exscan(&held, &heldOffset, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+	finishResults(opts, worldRank, balancedVec, (worldRank == MASTER) ? 0 : heldOffset);
+}
+
+//! Stream the input file through memory one window at a time. Each window is read balanced, rebalanced and
+//! computed like the decentralized mode, and written while the next one is processed; the read of the next
+//! window is already in flight meanwhile, so peak memory depends on the window size and not on the input size.
+void streamBalance(const Options& opts, const int worldSize, const int worldRank)
+{
+	ArenaVector<double> current, next, balancedVec, writing;
+	ArenaVector<double> capacity = initialCapacity(opts, worldSize);
+	MPI_Request readRequest = MPI_REQUEST_NULL, writeRequest = MPI_REQUEST_NULL;
+	long long numWindows = (opts.inputSize + opts.window - 1) / opts.window, held = 0;
+
+	if (numWindows > 0)
+		readWindow(opts, worldSize, worldRank, 0, std::min(opts.window, opts.inputSize), current, &readRequest);
+	for (long long w = 0; w < numWindows; w++)
+	{
+		double t = MPI_Wtime();
+		MPI_Wait(&readRequest, MPI_STATUS_IGNORE);
+		endPhase(opts, PHASE_IO, t);
+
+		long long begin = (w + 1) * opts.window;
+		if (begin < opts.inputSize)
+			readWindow(opts, worldSize, worldRank, begin, std::min(opts.window, opts.inputSize - begin), next,
+					   &readRequest);
+
+		decentralizedPass(opts, worldSize, worldRank, current, capacity, balancedVec);
+		held += static_cast<long long>(balancedVec.size());
+
+		//! The previous window's write has to finish before its buffer is reused
+		t = MPI_Wtime();
+		MPI_Wait(&writeRequest, MPI_STATUS_IGNORE);
+		endPhase(opts, PHASE_IO, t);
+		writing.swap(balancedVec);
+
+		long long count = static_cast<long long>(writing.size()), offset = 0;
+		MPI_Exscan(&count, &offset, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+		if (worldRank == MASTER)
+			offset = 0;
+		if (opts.output != MPI_FILE_NULL)
+		{
+			t = MPI_Wtime();
+			LargeCount large(count, MPI_DOUBLE);
+			MPI_File_iwrite_at_all(opts.output, static_cast<MPI_Offset>(w * opts.window + offset) * sizeof(double),
+								   writing.data(), large.count(), large.type(), &writeRequest);
+			endPhase(opts, PHASE_IO, t);
+		}
+		current.swap(next);
+	}
+
+	double t = MPI_Wtime();
+	MPI_Wait(&writeRequest, MPI_STATUS_IGNORE);
+	endPhase(opts, PHASE_IO, t);
+	recordHeld(opts, held);
+}
+
+//! Moves of node surpluses to node deficits, as flows[from * numNodes + to] angles. Surpluses and deficits are
+//! matched in node order, so exactly the excess of each node leaves it and nothing else crosses the network.
+std::vector<long long> surplusFlows(const std::vector<long long>& held, const std::vector<long long>& target)
+{
+	size_t numNodes = held.size();
+	std::vector<long long> flows(numNodes * numNodes, 0);
+	size_t to = 0;
+	long long deficit = 0;
+	for (size_t from = 0; from < numNodes; from++)
+	{
+		long long surplus = held[from] - target[from];
+		while (surplus > 0)
+		{
+			while (deficit == 0)
+			{
+				deficit = std::max(0LL, target[to] - held[to]);
+				if (deficit == 0)
+					to++;
+			}
+			long long moved = std::min(surplus, deficit);
+			flows[from * numNodes + to] += moved;
+			surplus -= moved;
+			deficit -= moved;
+			if (deficit == 0)
+				to++;
+		}
+	}
+
+	return flows;
+}
+
+//! Start of the node array of a shared window: segments are contiguous in node rank order, and the lowest one
+//! that is not empty is found with MPI_PROC_NULL
+double *sharedBase(MPI_Win win)
+{
+	MPI_Aint size;
+	int dispUnit;
+	double *base = nullptr;
+	MPI_Win_shared_query(win, MPI_PROC_NULL, &size, &dispUnit, &base);
+
+	return base;
+}
+
+//! Make the stores of every rank of a node to its shared windows visible to the others
+void nodeSync(const std::vector<MPI_Win>& windows, const MPI_Comm nodeComm)
+{
+	for (size_t i = 0; i < windows.size(); i++)
+		MPI_Win_sync(windows[i]);
+	MPI_Barrier(nodeComm);
+	for (size_t i = 0; i < windows.size(); i++)
+		MPI_Win_sync(windows[i]);
+}
+
+//! Two-level balancing. The ranks of each shared-memory node load their angles straight into one node array in
+//! a shared window. Node leaders then move only the surplus of each node, compared to its share of the global
+//! work, to the nodes short of theirs. Every rank computes its share of the node's angles straight out of shared
+//! memory, and the results of moved angles travel back the same way, so every rank ends up with its own angles'
+//! results.
+void hierarchicalBalance(const Options& opts, const int worldSize, const int worldRank)
+{
+	//! Nodes are shared-memory domains, optionally cut into groups of --node-size ranks
+	double t = MPI_Wtime();
+	MPI_Comm sharedComm, nodeComm, leaderComm;
+	MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, worldRank, MPI_INFO_NULL, &sharedComm);
+	int sharedRank;
+	MPI_Comm_rank(sharedComm, &sharedRank);
+	MPI_Comm_split(sharedComm, (opts.nodeSize > 0) ? sharedRank / opts.nodeSize : 0, worldRank, &nodeComm);
+	MPI_Comm_free(&sharedComm);
+	int nodeRank, nodeSize;
+	MPI_Comm_rank(nodeComm, &nodeRank);
+	MPI_Comm_size(nodeComm, &nodeSize);
+	MPI_Comm_split(MPI_COMM_WORLD, (nodeRank == 0) ? 0 : MPI_UNDEFINED, worldRank, &leaderComm);
+
+	//! The world master is node rank 0 of its node, since ranks are ordered by world rank. Angles are counted
+	//! first, so that they can be loaded straight into this rank's segment of the node array.
+	long long count = angleCount(opts, worldSize, worldRank);
+	std::vector<long long> segments(static_cast<size_t>(nodeSize));
+	MPI_Allgather(&count, 1, MPI_LONG_LONG, segments.data(), 1, MPI_LONG_LONG, nodeComm);
+	std::vector<long long> segmentDispls = displacements(segments);
+	long long held = segmentDispls.back() + segments.back();
+	int worker = ((worldRank != MASTER) || opts.masterComputes) ? 1 : 0, workers;
+	int master = (worldRank == MASTER) ? 1 : 0, hasMaster;
+	MPI_Allreduce(&worker, &workers, 1, MPI_INT, MPI_SUM, nodeComm);
+	MPI_Allreduce(&master, &hasMaster, 1, MPI_INT, MPI_MAX, nodeComm);
+
+	//! Leaders share their nodes' angle and worker counts and derive the same targets and surplus flows
+	int numNodes = 0, node = 0;
+	std::vector<long long> flows, nodeHeld, target;
+	long long counts[2] = {held, workers}, sizes[2];
+	if (leaderComm != MPI_COMM_NULL)
+	{
+		MPI_Comm_size(leaderComm, &numNodes);
+		MPI_Comm_rank(leaderComm, &node);
+		std::vector<long long> all(2 * static_cast<size_t>(numNodes));
+		MPI_Allgather(counts, 2, MPI_LONG_LONG, all.data(), 2, MPI_LONG_LONG, leaderComm);
+
+		long long total = 0, totalWorkers = 0, prefix = 0;
+		nodeHeld.resize(static_cast<size_t>(numNodes));
+		target.resize(static_cast<size_t>(numNodes));
+		for (int n = 0; n < numNodes; n++)
+		{
+			nodeHeld[n] = all[2 * n];
+			total += all[2 * n];
+			totalWorkers += all[2 * n + 1];
+		}
+		for (int n = 0; n < numNodes; n++)
+		{
+			if (totalWorkers == 0)
+			{
+				target[n] = nodeHeld[n];
+				continue;
+			}
+			long long begin = static_cast<long long>(static_cast<long double>(total) * prefix / totalWorkers);
+			prefix += all[2 * n + 1];
+			target[n] = static_cast<long long>(static_cast<long double>(total) * prefix / totalWorkers) - begin;
+		}
+		flows = surplusFlows(nodeHeld, target);
+		sizes[0] = target[node];
+		sizes[1] = std::max(0LL, target[node] - held);
+	}
+	MPI_Bcast(sizes, 2, MPI_LONG_LONG, 0, nodeComm);
+	long long nodeTarget = sizes[0], imports = sizes[1];
+
+	//! Node arrays of own angles and of imported ones, with result arrays of the same layout
+	MPI_Win angleWin, resultWin, importWin, importResultWin;
+	double *mine, *mineResults, *importSegment, *importResultSegment;
+	MPI_Aint bytes = static_cast<MPI_Aint>(count) * sizeof(double);
+	MPI_Aint importBytes = (nodeRank == 0) ? static_cast<MPI_Aint>(imports) * sizeof(double) : 0;
+	MPI_Win_allocate_shared(bytes, sizeof(double), MPI_INFO_NULL, nodeComm, &mine, &angleWin);
+	MPI_Win_allocate_shared(bytes, sizeof(double), MPI_INFO_NULL, nodeComm, &mineResults, &resultWin);
+	MPI_Win_allocate_shared(importBytes, sizeof(double), MPI_INFO_NULL, nodeComm, &importSegment, &importWin);
+	MPI_Win_allocate_shared(importBytes, sizeof(double), MPI_INFO_NULL, nodeComm, &importResultSegment,
+							&importResultWin);
+	std::vector<MPI_Win> windows = {angleWin, resultWin, importWin, importResultWin};
+	for (size_t i = 0; i < windows.size(); i++)
+		MPI_Win_lock_all(MPI_MODE_NOCHECK, windows[i]);
+	double *angles = sharedBase(angleWin), *results = sharedBase(resultWin);
+	double *imported = sharedBase(importWin), *importedResults = sharedBase(importResultWin);
+	endPhase(opts, PHASE_COUNTS, t);
+	loadAngles(opts, worldSize, worldRank, mine, count);
+	t = MPI_Wtime();
+	nodeSync(windows, nodeComm);
+
+	//! Leaders send the tail of their node array beyond the node's target and receive imports behind each other
+	long long kept = std::min(held, nodeTarget);
+	std::vector<MPI_Request> requests;
+	if (leaderComm != MPI_COMM_NULL)
+	{
+		long long sent = 0, received = 0;
+		for (int n = 0; n < numNodes; n++)
+		{
+			long long out = flows[static_cast<size_t>(node) * numNodes + n];
+			long long in = flows[static_cast<size_t>(n) * numNodes + node];
+			if (out > 0)
+			{
+				requests.emplace_back();
+				traceIsend(opts, angles + kept + sent, out, MPI_DOUBLE, n, TAG_WORK, leaderComm, &requests.back());
+				sent += out;
+			}
+			if (in > 0)
+			{
+				requests.emplace_back();
+				traceIrecv(opts, imported + received, in, MPI_DOUBLE, n, TAG_WORK, leaderComm, &requests.back());
+				received += in;
+			}
+		}
+		traceWaitall(opts, static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+	}
+	nodeSync(windows, nodeComm);
+	endPhase(opts, PHASE_REDISTRIBUTE, t);
+
+	//! Every rank computes its share of the node's kept and imported angles in place
+	std::vector<long long> shares = balancedCounts(nodeTarget, nodeSize, opts.masterComputes || (hasMaster == 0));
+	long long begin = displacements(shares)[nodeRank], end = begin + shares[nodeRank];
+	recordHeld(opts, end - begin);
+	if (begin < kept)
+	{
+		size_t n = static_cast<size_t>(std::min(end, kept) - begin);
+		runKernel(opts, angles + begin, results + begin, n);
+		reportSines(opts, worldRank, angles + begin, results + begin, n);
+	}
+	if (end > kept)
+	{
+		long long first = std::max(begin, kept) - kept;
+		size_t n = static_cast<size_t>(end - kept - first);
+		runKernel(opts, imported + first, importedResults + first, n);
+		reportSines(opts, worldRank, imported + first, importedResults + first, n);
+	}
+
+	//! Results of the moved angles go back to the leaders they came from
+	t = MPI_Wtime();
+	nodeSync(windows, nodeComm);
+	if (leaderComm != MPI_COMM_NULL)
+	{
+		requests.clear();
+		long long sent = 0, received = 0;
+		for (int n = 0; n < numNodes; n++)
+		{
+			long long out = flows[static_cast<size_t>(node) * numNodes + n];
+			long long in = flows[static_cast<size_t>(n) * numNodes + node];
+			if (out > 0)
+			{
+				requests.emplace_back();
+				traceIrecv(opts, results + kept + sent, out, MPI_DOUBLE, n, TAG_RESULT, leaderComm,
+						   &requests.back());
+				sent += out;
+			}
+			if (in > 0)
+			{
+				requests.emplace_back();
+				traceIsend(opts, importedResults + received, in, MPI_DOUBLE, n, TAG_RESULT, leaderComm,
+						   &requests.back());
+				received += in;
+			}
+		}
+		traceWaitall(opts, static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+	}
+	nodeSync(windows, nodeComm);
+	endPhase(opts, PHASE_RESULTS, t);
+
+	//! Every rank's results are now in its own segment, in the order of its angles
+	long long offset = 0;
+	MPI_Exscan(&count, &offset, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+	finishResults(opts, worldRank, mineResults, count, (worldRank == MASTER) ? 0 : offset);
+
+	for (size_t i = 0; i < windows.size(); i++)
+	{
+		MPI_Win_unlock_all(windows[i]);
+		MPI_Win_free(&windows[i]);
+	}
+	if (leaderComm != MPI_COMM_NULL)
+		MPI_Comm_free(&leaderComm);
+	MPI_Comm_free(&nodeComm);
+}
+
+//! Diffusion rounds per timestep at most; first-order diffusion converges geometrically, so this bounds the
+//! rare timesteps after a large jump in the counts
+const int DIFFUSION_ROUNDS = 32;
+
+//! Angles a rank with load from sends to a neighbour with load to: a third of the difference, so a rank never
+//! gives away more than it holds even to both neighbours at once, rounded so that a difference of two evens out
+long long diffusionFlow(const long long from, const long long to)
+{
+	return std::max(0LL, (from - to + 1) / 3);
+}
+
+//! Let a rank's angles drift by up to --drift of their number: new angles are generated at the tail, or the
+//! tail is dropped
+void driftAngles(const Options& opts, const int worldRank, const int step, ArenaVector<double>& angles)
+{
+	Xoshiro256 rng(opts.seed, worldRank, STREAM_DRIFT, static_cast<uint64_t>(step));
+	long long size = static_cast<long long>(angles.size());
+	long long change = std::llround(opts.drift * static_cast<double>(size) * rng.uniform(-1.0, 1.0));
+	if (change < 0)
+		angles.resize(static_cast<size_t>(size + change));
+	for (long long i = 0; i < change; i++)
+		angles.push_back(rng.uniform(opts.angleMin, opts.angleMax));
+}
+
+//! Long-running iterative balancing: every --iterations timestep computes the angles each rank holds. The
+//! ranks doing work form a chain, and a timestep rebalances only once the imbalance of the angle counts exceeds
+//! --threshold. Then rounds of first-order diffusion move a third of the difference to a less loaded neighbour,
+//! until the threshold is met again. Angles leave from the end facing the neighbour, so every rank still holds
+//! a contiguous range in global order. The load exchange of every round reuses persistent requests.
+void diffusionBalance(const Options& opts, const int worldSize, const int worldRank)
+{
+	ArenaVector<double> angles, incoming, next, results;
+	loadAngles(opts, worldSize, worldRank, angles);
+
+	//! Chain neighbours; the master only takes part when it computes
+	bool worker = (worldRank != MASTER) || opts.masterComputes;
+	int first = opts.masterComputes ? 0 : 1;
+	int left = (worker && (worldRank > first)) ? worldRank - 1 : MPI_PROC_NULL;
+	int right = (worker && (worldRank < worldSize - 1)) ? worldRank + 1 : MPI_PROC_NULL;
+	int workers = worldSize - first;
+	int neighbours = ((left != MPI_PROC_NULL) ? 1 : 0) + ((right != MPI_PROC_NULL) ? 1 : 0);
+
+	long long load = 0, leftLoad = 0, rightLoad = 0;
+	MPI_Request loadRequests[4];
+	MPI_Send_init(&load, 1, MPI_LONG_LONG, left, TAG_LOAD, MPI_COMM_WORLD, &loadRequests[0]);
+	MPI_Send_init(&load, 1, MPI_LONG_LONG, right, TAG_LOAD, MPI_COMM_WORLD, &loadRequests[1]);
+	MPI_Recv_init(&leftLoad, 1, MPI_LONG_LONG, left, TAG_LOAD, MPI_COMM_WORLD, &loadRequests[2]);
+	MPI_Recv_init(&rightLoad, 1, MPI_LONG_LONG, right, TAG_LOAD, MPI_COMM_WORLD, &loadRequests[3]);
+
+	int rebalanced = 0, rounds = 0;
+	long long moved = 0;
+	for (int step = 0; step < opts.iterations; step++)
+	{
+		if ((step > 0) && (opts.drift > 0.0) && worker)
+			driftAngles(opts, worldRank, step, angles);
+
+		//! Global imbalance from the maximum and the sum of the loads; rounds also stop once diffusion has
+		//! nothing left to move
+		double t = MPI_Wtime();
+		long long roundMoved = 0;
+		for (int round = 0; round <= DIFFUSION_ROUNDS; round++)
+		{
+			load = static_cast<long long>(angles.size());
+			long long maxLoad, sums[2], local[2] = {load, roundMoved};
+			MPI_Allreduce(&load, &maxLoad, 1, MPI_LONG_LONG, MPI_MAX, MPI_COMM_WORLD);
+			MPI_Allreduce(local, sums, 2, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+			double mean = static_cast<double>(sums[0]) / std::max(1, workers);
+			if ((round == DIFFUSION_ROUNDS) || ((round > 0) && (sums[1] == 0))
+				|| (static_cast<double>(maxLoad) <= opts.threshold * mean))
+				break;
+			if (round == 0)
+				rebalanced++;
+			rounds++;
+			t = endPhase(opts, PHASE_COUNTS, t);
+
+			//! Both ends of a link derive the same flow from the two loads
+			traceStartWaitall(opts, 4, loadRequests);
+			countBytes(opts, neighbours * sizeof(long long), neighbours * sizeof(long long));
+			long long toLeft = (left != MPI_PROC_NULL) ? diffusionFlow(load, leftLoad) : 0;
+			long long toRight = (right != MPI_PROC_NULL) ? diffusionFlow(load, rightLoad) : 0;
+			long long fromLeft = (left != MPI_PROC_NULL) ? diffusionFlow(leftLoad, load) : 0;
+			long long fromRight = (right != MPI_PROC_NULL) ? diffusionFlow(rightLoad, load) : 0;
+
+			incoming.resize(static_cast<size_t>(fromLeft + fromRight));
+			MPI_Request requests[4];
+			traceIrecv(opts, incoming.data(), fromLeft, MPI_DOUBLE, left, TAG_WORK, MPI_COMM_WORLD, &requests[0]);
+			traceIrecv(opts, incoming.data() + fromLeft, fromRight, MPI_DOUBLE, right, TAG_WORK, MPI_COMM_WORLD,
+					   &requests[1]);
+			traceIsend(opts, angles.data(), toLeft, MPI_DOUBLE, left, TAG_WORK, MPI_COMM_WORLD, &requests[2]);
+			traceIsend(opts, angles.data() + load - toRight, toRight, MPI_DOUBLE, right, TAG_WORK, MPI_COMM_WORLD,
+					   &requests[3]);
+			traceWaitall(opts, 4, requests, MPI_STATUSES_IGNORE);
+
+			next.assign(incoming.begin(), incoming.begin() + fromLeft);
+			next.insert(next.end(), angles.begin() + toLeft, angles.end() - toRight);
+			next.insert(next.end(), incoming.begin() + fromLeft, incoming.end());
+			angles.swap(next);
+			roundMoved = toLeft + toRight;
+			moved += roundMoved;
+			t = endPhase(opts, PHASE_REDISTRIBUTE, t);
+		}
+		endPhase(opts, PHASE_COUNTS, t);
+
+		results.resize(angles.size());
+		if (!angles.empty())
+		{
+			runKernel(opts, angles.data(), results.data(), angles.size());
+			reportSines(opts, worldRank, angles.data(), results.data(), angles.size());
+		}
+	}
+	recordHeld(opts, static_cast<long long>(angles.size()));
+
+	for (int i = 0; i < 4; i++)
+		MPI_Request_free(&loadRequests[i]);
+
+	long long totalMoved = 0;
+	MPI_Reduce(&moved, &totalMoved, 1, MPI_LONG_LONG, MPI_SUM, MASTER, MPI_COMM_WORLD);
+	if ((worldRank == MASTER) && (opts.verbosity >= VERBOSITY_SUMMARY) && !opts.bench)
+		std::cout << "Rebalanced in " << rebalanced << " of " << opts.iterations << " timesteps, " << rounds
+				  << " diffusion rounds, " << totalMoved << " angles moved" << std::endl;
+
+	//! Ranges stay contiguous in global order, so the last timestep's results go to their global offsets
+	long long held = static_cast<long long>(results.size()), offset = 0;
+	MPI_Exscan(&held, &offset, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+	finishResults(opts, worldRank, results, (worldRank == MASTER) ? 0 : offset);
+}
+
+//! Size of the next chunk handed out by the dynamic queue
+long long nextChunk(const Options& opts, const long long remaining, const int workers)
+{
+	long long chunk = opts.chunk;
+	if (opts.schedule == Schedule::GUIDED)
+		chunk = std::max(chunk, (remaining + 2 * workers - 1) / (2 * workers));
+
+	return std::min(chunk, remaining);
+}
+
+//! Seconds the fault-tolerant master sleeps between polls while nothing arrives, and between checkpoint flushes
+const double POLL_INTERVAL = 1.0e-4;
+const double CHECKPOINT_INTERVAL = 1.0;
+
+//! First word of a checkpoint file ("LBCKPT01")
+const uint64_t CHECKPOINT_MAGIC = 0x313054504b43424cULL;
+
+//! FNV-1a hash of the angles' bit patterns, so a checkpoint is only resumed for the input it was written for
+uint64_t anglesHash(const ArenaVector<double>& angles)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	const unsigned char *bytes = reinterpret_cast<const unsigned char *>(angles.data());
+	for (size_t i = 0; i < angles.size() * sizeof(double); i++)
+		hash = (hash ^ bytes[i]) * 1099511628211ULL;
+
+	return hash;
+}
+
+//! Completed ranges of the dynamic mode's results on the master: a header identifying the input, then one
+//! (begin, count, sine values) record per finished chunk, flushed every CHECKPOINT_INTERVAL. A file written
+//! for the same input is resumed: its complete records are restored and compacted into a fresh file, and a
+//! record cut short by a crash is dropped.
+class Checkpoint
+{
+public:
+	//! Without a path nothing is read or written
+	Checkpoint(const std::string& path, const ArenaVector<double>& angles, ArenaVector<double>& results,
+			   std::vector<std::pair<long long, long long>>& restored)
+	{
+		if (path.empty())
+			return;
+
+		uint64_t header[3] = {CHECKPOINT_MAGIC, static_cast<uint64_t>(angles.size()), anglesHash(angles)};
+		uint64_t stored[3] = {0, 0, 0};
+		std::ifstream in(path.c_str(), std::ios::binary);
+		if (in.read(reinterpret_cast<char *>(stored), sizeof(stored)) && std::equal(header, header + 3, stored))
+		{
+			long long total = static_cast<long long>(angles.size());
+			long long range[2];
+			while (in.read(reinterpret_cast<char *>(range), sizeof(range)))
+			{
+				if ((range[0] < 0) || (range[1] <= 0) || (range[0] + range[1] > total)
+					|| !in.read(reinterpret_cast<char *>(results.data() + range[0]), range[1] * sizeof(double)))
+					break;
+				restored.push_back(std::make_pair(range[0], range[1]));
+			}
+		}
+		in.close();
+		std::sort(restored.begin(), restored.end());
+
+		m_out.open(path.c_str(), std::ios::binary | std::ios::trunc);
+		m_out.write(reinterpret_cast<const char *>(header), sizeof(header));
+		for (size_t i = 0; i < restored.size(); i++)
+			record(restored[i].first, restored[i].second, results.data() + restored[i].first);
+		m_out.flush();
+		m_flushed = MPI_Wtime();
+	}
+
+	~Checkpoint()
+	{
+		if (m_out.is_open())
+			m_out.flush();
+	}
+
+	void record(const long long begin, const long long count, const double *values)
+	{
+		if (!m_out.is_open())
+			return;
+
+		long long range[2] = {begin, count};
+		m_out.write(reinterpret_cast<const char *>(range), sizeof(range));
+		m_out.write(reinterpret_cast<const char *>(values), count * sizeof(double));
+		if (MPI_Wtime() - m_flushed > CHECKPOINT_INTERVAL)
+		{
+			m_out.flush();
+			m_flushed = MPI_Wtime();
+		}
+	}
+
+private:
+	std::ofstream m_out;
+	double m_flushed = 0.0;
+};
+
+//! A range of the dynamic queue and how far it got
+struct Chunk
+{
+	long long begin, count;
+	int copies;		//!< Ranks it was handed to
+	bool done;		//!< Results are in
+	bool queued;	//!< Waiting to be handed out again
+};
+
+//! Workers still out when every result of the dynamic queue is in: ranks running a timed-out or duplicate
+//! chunk, or yet to send their first request. Their results are received into scratch buffers and discarded and
+//! their stops sent without holding up the master; finish() completes both at the end of the mode. A rank that
+//! never returns still blocks shutdown, since the output write and the summary are collective over all ranks.
+class LateResults
+{
+public:
+	void post(const Options& opts, const int rank, const long long maxChunk)
+	{
+		m_buffers.emplace_back(static_cast<size_t>(maxChunk));
+		m_requests.resize(m_requests.size() + 2, MPI_REQUEST_NULL);
+		traceIrecv(opts, m_buffers.back().data(), maxChunk, MPI_DOUBLE, rank, TAG_RESULT, MPI_COMM_WORLD,
+				   &m_requests[m_requests.size() - 2]);
+		traceIsend(opts, nullptr, 0, MPI_DOUBLE, rank, TAG_WORK, MPI_COMM_WORLD, &m_requests.back());
+	}
+
+	void finish(const Options& opts)
+	{
+		double t = MPI_Wtime();
+		traceWaitall(opts, static_cast<int>(m_requests.size()), m_requests.data(), MPI_STATUSES_IGNORE);
+		endPhase(opts, PHASE_RESULTS, t);
+		m_requests.clear();
+		m_buffers.clear();
+	}
+
+private:
+	std::deque<ArenaVector<double>> m_buffers;	//!< Stable addresses while receives are pending
+	std::vector<MPI_Request> m_requests;
+};
+
+//! Master of the dynamic queue with straggler mitigation. It polls with MPI_Test instead of blocking, so a
+//! chunk outstanding for more than --timeout seconds is handed to the next idle rank, and with --speculate an
+//! idle rank duplicates the longest-running chunk once the queue is empty; the first copy to return wins and
+//! later ones are discarded. Idle ranks are held back rather than stopped while work is outstanding. The
+//! worker side is unchanged: results double as requests and an empty chunk stops the worker. Once every result
+//! is in, the master returns without waiting for the ranks still out, which late takes over.
+void resilientMaster(const Options& opts, const int worldSize, const int worldRank,
+					 const ArenaVector<double>& masterVec, ArenaVector<double>& resultVec, const long long maxChunk,
+					 LateResults& late)
+{
+	long long total = static_cast<long long>(masterVec.size());
+	int workers = opts.masterComputes ? worldSize : worldSize - 1;
+	int slaves = worldSize - 1;
+	resultVec.resize(masterVec.size());
+
+	//! Ranges left to hand out are the gaps between those restored from the checkpoint
+	std::vector<std::pair<long long, long long>> restored, todo;
+	Checkpoint checkpoint(opts.checkpoint, masterVec, resultVec, restored);
+	long long doneAngles = 0, begin = 0;
+	for (size_t i = 0; i < restored.size(); i++)
+	{
+		if (restored[i].first > begin)
+			todo.push_back(std::make_pair(begin, restored[i].first));
+		begin = restored[i].first + restored[i].second;
+		doneAngles += restored[i].second;
+	}
+	if (begin < total)
+		todo.push_back(std::make_pair(begin, total));
+	long long restoredAngles = doneAngles, remaining = total - doneAngles;
+
+	std::vector<Chunk> chunks;
+	std::deque<int> queue;
+	size_t todoIndex = 0;
+	long long cursor = todo.empty() ? total : todo[0].first;
+	std::vector<int> current(static_cast<size_t>(worldSize), -1);
+	std::vector<double> started(static_cast<size_t>(worldSize), 0.0);
+	std::vector<char> timedOut(static_cast<size_t>(worldSize), 0), parked(static_cast<size_t>(worldSize), 0);
+	std::vector<char> stopped(static_cast<size_t>(worldSize), 0);
+	std::vector<MPI_Request> sendRequests(static_cast<size_t>(worldSize), MPI_REQUEST_NULL);
+	long long redispatched = 0, speculative = 0, discarded = 0;
+
+	//! Re-queued chunks first, then fresh ones, then (speculating) a copy of the one running longest
+	auto pickChunk = [&](const int rank) -> int
+	{
+		while (!queue.empty())
+		{
+			int c = queue.front();
+			queue.pop_front();
+			chunks[c].queued = false;
+			if (!chunks[c].done)
+				return c;
+		}
+		if (todoIndex < todo.size())
+		{
+			long long count = std::min(nextChunk(opts, remaining, workers), todo[todoIndex].second - cursor);
+			chunks.push_back(Chunk{cursor, count, 0, false, false});
+			cursor += count;
+			remaining -= count;
+			if ((cursor == todo[todoIndex].second) && (++todoIndex < todo.size()))
+				cursor = todo[todoIndex].first;
+			return static_cast<int>(chunks.size()) - 1;
+		}
+		if (!opts.speculate)
+			return -1;
+
+		int oldest = -1;
+		for (int w = 1; w < worldSize; w++)
+			if ((w != rank) && (current[w] >= 0) && !chunks[current[w]].done && (chunks[current[w]].copies == 1)
+				&& ((oldest < 0) || (started[w] < started[oldest])))
+				oldest = w;
+		if (oldest < 0)
+			return -1;
+		speculative++;
+		return current[oldest];
+	};
+
+	auto dispatch = [&](const int rank, const int c)
+	{
+		traceWait(opts, &sendRequests[rank], MPI_STATUS_IGNORE);
+		traceIsend(opts, masterVec.data() + chunks[c].begin, chunks[c].count, MPI_DOUBLE, rank, TAG_WORK,
+				   MPI_COMM_WORLD, &sendRequests[rank]);
+		chunks[c].copies++;
+		current[rank] = c;
+		started[rank] = MPI_Wtime();
+		timedOut[rank] = 0;
+		parked[rank] = 0;
+	};
+
+	auto stop = [&](const int rank)
+	{
+		traceWait(opts, &sendRequests[rank], MPI_STATUS_IGNORE);
+		traceIsend(opts, nullptr, 0, MPI_DOUBLE, rank, TAG_WORK, MPI_COMM_WORLD, &sendRequests[rank]);
+		parked[rank] = 0;
+		stopped[rank] = 1;
+	};
+
+	//! Store a chunk's results unless another copy was first; once all are in, release the held-back ranks
+	auto complete = [&](const int c, const double *values) -> bool
+	{
+		if (chunks[c].done)
+			return false;
+		std::copy(values, values + chunks[c].count, resultVec.begin() + chunks[c].begin);
+		checkpoint.record(chunks[c].begin, chunks[c].count, values);
+		chunks[c].done = true;
+		doneAngles += chunks[c].count;
+		if (doneAngles == total)
+			for (int w = 1; w < worldSize; w++)
+				if (parked[w])
+					stop(w);
+		return true;
+	};
+
+	ArenaVector<double> recvVec(static_cast<size_t>(maxChunk));
+	LargeCount recvCount(maxChunk, MPI_DOUBLE);
+	MPI_Request recvRequest = MPI_REQUEST_NULL;
+	if (slaves > 0)
+		MPI_Irecv(recvVec.data(), recvCount.count(), recvCount.type(), MPI_ANY_SOURCE, TAG_RESULT, MPI_COMM_WORLD,
+				  &recvRequest);
+
+	while (doneAngles < total)
+	{
+		double t = MPI_Wtime();
+		int done = 0;
+		MPI_Status status;
+		if (recvRequest != MPI_REQUEST_NULL)
+			traceTest(opts, &recvRequest, &done, &status);
+		t = endPhase(opts, PHASE_RESULTS, t);
+
+		if (done)
+		{
+			//! Results of the worker's previous chunk (empty on its first request)
+			int source = status.MPI_SOURCE;
+			MPI_Count count;
+			MPI_Get_elements_x(&status, recvCount.type(), &count);
+			countBytes(opts, 0, typeBytes(count, MPI_DOUBLE));
+			if ((current[source] >= 0) && !complete(current[source], recvVec.data()))
+				discarded++;
+			current[source] = -1;
+
+			int c = (doneAngles < total) ? pickChunk(source) : -1;
+			if (c >= 0)
+				dispatch(source, c);
+			else if (doneAngles < total)
+				parked[source] = 1;
+			else
+				stop(source);
+
+			long long waiting = slaves - std::count(stopped.begin(), stopped.end(), 1)
+								- std::count(parked.begin(), parked.end(), 1);
+			if (waiting > 0)
+				MPI_Irecv(recvVec.data(), recvCount.count(), recvCount.type(), MPI_ANY_SOURCE, TAG_RESULT,
+						  MPI_COMM_WORLD, &recvRequest);
+			endPhase(opts, PHASE_REDISTRIBUTE, t);
+			continue;
+		}
+
+		//! Chunks outstanding past the timeout go back in the queue, once per assignment
+		double now = MPI_Wtime();
+		for (int w = 1; w < worldSize; w++)
+		{
+			int c = current[w];
+			if ((opts.timeout > 0.0) && (c >= 0) && !timedOut[w] && !chunks[c].done && !chunks[c].queued
+				&& (now - started[w] > opts.timeout))
+			{
+				timedOut[w] = 1;
+				chunks[c].queued = true;
+				queue.push_back(c);
+				redispatched++;
+			}
+		}
+
+		//! Held-back ranks take queued or speculative work, and a returning rank needs a receive posted again
+		bool dispatched = false;
+		for (int w = 1; w < worldSize; w++)
+		{
+			int c = parked[w] ? pickChunk(w) : -1;
+			if (c >= 0)
+			{
+				dispatch(w, c);
+				dispatched = true;
+			}
+		}
+		if (dispatched && (recvRequest == MPI_REQUEST_NULL))
+			MPI_Irecv(recvVec.data(), recvCount.count(), recvCount.type(), MPI_ANY_SOURCE, TAG_RESULT,
+					  MPI_COMM_WORLD, &recvRequest);
+		endPhase(opts, PHASE_REDISTRIBUTE, t);
+
+		//! Master takes a chunk itself while no worker is waiting
+		int c = (opts.masterComputes && (doneAngles < total)) ? pickChunk(MASTER) : -1;
+		if (c >= 0)
+		{
+			ArenaVector<double> angles(masterVec.begin() + chunks[c].begin,
+									   masterVec.begin() + chunks[c].begin + chunks[c].count);
+			chunks[c].copies++;
+			computeSine(opts, worldRank, angles);
+			complete(c, angles.data());
+		}
+		else if (!dispatched)
+			std::this_thread::sleep_for(std::chrono::duration<double>(POLL_INTERVAL));
+	}
+
+	//! A request that arrived in the meantime is answered with a stop; every other rank still out is left to late
+	double t = MPI_Wtime();
+	if (recvRequest != MPI_REQUEST_NULL)
+	{
+		MPI_Status status;
+		int cancelled;
+		MPI_Cancel(&recvRequest);
+		MPI_Wait(&recvRequest, &status);
+		MPI_Test_cancelled(&status, &cancelled);
+		if (!cancelled)
+		{
+			int source = status.MPI_SOURCE;
+			MPI_Count count;
+			MPI_Get_elements_x(&status, recvCount.type(), &count);
+			countBytes(opts, 0, typeBytes(count, MPI_DOUBLE));
+			if (current[source] >= 0)
+				discarded++;
+			current[source] = -1;
+			stop(source);
+		}
+	}
+	for (int w = 1; w < worldSize; w++)
+	{
+		if (stopped[w])
+			continue;
+		if (current[w] >= 0)
+			discarded++;
+		late.post(opts, w, maxChunk);
+	}
+	traceWaitall(opts, worldSize, sendRequests.data(), MPI_STATUSES_IGNORE);
+	endPhase(opts, PHASE_REDISTRIBUTE, t);
+
+	if ((opts.verbosity >= VERBOSITY_SUMMARY) && !opts.bench)
+		std::cout << "Chunks re-dispatched after timeouts = " << redispatched << ", speculative copies = "
+				  << speculative << ", duplicate results discarded = " << discarded
+				  << ", angles restored from checkpoint = " << restoredAngles << std::endl;
+}
+
+//! Balance at run time: workers return each finished chunk to the master, which answers with the next one,
+//! so faster ranks naturally take more of the work
+void dynamicBalance(const Options& opts, const int worldSize, const int worldRank)
+{
+	ArenaVector<double> masterVec, slaveVec, resultVec;
+	LateResults late;
+
+	loadAngles(opts, worldSize, worldRank, slaveVec);
+	gatherToMaster(opts, PHASE_COUNTS, PHASE_GATHER, worldSize, worldRank, slaveVec, masterVec);
+
+	//! Largest chunk ever handed out, so workers can size their receive buffer once
+	long long total = static_cast<long long>(masterVec.size());
+	int workers = opts.masterComputes ? worldSize : worldSize - 1;
+	long long maxChunk = 0;
+	if (worldRank == MASTER)
+	{
+		printVector(opts, "Master vector", masterVec);
+
+		maxChunk = nextChunk(opts, total, workers);
+	}
+	double t = MPI_Wtime();
+	MPI_Bcast(&maxChunk, 1, MPI_LONG_LONG, MASTER, MPI_COMM_WORLD);
+	endPhase(opts, PHASE_COUNTS, t);
+
+	if ((worldRank == MASTER) && ((opts.timeout > 0.0) || opts.speculate || !opts.checkpoint.empty()))
+	{
+		resilientMaster(opts, worldSize, worldRank, masterVec, resultVec, maxChunk, late);
+		printVector(opts, "Final Master vector", resultVec);
+	}
+	else if (worldRank == MASTER)
+	{
+		resultVec.resize(masterVec.size());
+		ArenaVector<double> recvVec(static_cast<size_t>(maxChunk));
+		std::vector<long long> assigned(static_cast<size_t>(worldSize), 0);
+		std::vector<MPI_Request> sendRequests(static_cast<size_t>(worldSize), MPI_REQUEST_NULL);
+		long long next = 0;
+		int active = worldSize - 1;
+
+		//! Serve requests in arrival order; the receive buffer fits any chunk, so bytes are counted on arrival
+		LargeCount recvCount(maxChunk, MPI_DOUBLE);
+		MPI_Request recvRequest = MPI_REQUEST_NULL;
+		if (active > 0)
+			MPI_Irecv(recvVec.data(), recvCount.count(), recvCount.type(), MPI_ANY_SOURCE, TAG_RESULT, MPI_COMM_WORLD,
+					  &recvRequest);
+
+		while ((active > 0) || (opts.masterComputes && (next < total)))
+		{
+			//! Waiting for a worker is charged to results, answering it to redistribution
+			t = MPI_Wtime();
+			int done = 0;
+			MPI_Status status;
+			if (active == 0)
+				done = 0;
+			else if (opts.masterComputes && (next < total))
+				traceTest(opts, &recvRequest, &done, &status);
+			else
+			{
+				traceWait(opts, &recvRequest, &status);
+				done = 1;
+			}
+			t = endPhase(opts, PHASE_RESULTS, t);
+
+			//! Master takes a chunk itself while no worker is waiting
+			if (!done)
+			{
+				long long chunk = nextChunk(opts, total - next, workers);
+				slaveVec.assign(masterVec.begin() + next, masterVec.begin() + next + chunk);
+				computeSine(opts, worldRank, slaveVec);
+				std::copy(slaveVec.begin(), slaveVec.end(), resultVec.begin() + next);
+				next += chunk;
+				continue;
+			}
+
+			//! Results of the worker's previous chunk (empty on its first request)
+			int source = status.MPI_SOURCE;
+			MPI_Count count;
+			MPI_Get_elements_x(&status, recvCount.type(), &count);
+			countBytes(opts, 0, typeBytes(count, MPI_DOUBLE));
+			std::copy(recvVec.begin(), recvVec.begin() + count, resultVec.begin() + assigned[source]);
+
+			//! Hand out the next chunk straight from the master vector; an empty chunk tells the worker to stop
+			long long chunk = nextChunk(opts, total - next, workers);
+			traceWait(opts, &sendRequests[source], MPI_STATUS_IGNORE);
+			traceIsend(opts, masterVec.data() + next, chunk, MPI_DOUBLE, source, TAG_WORK, MPI_COMM_WORLD,
+					   &sendRequests[source]);
+			assigned[source] = next;
+			next += chunk;
+
+			if (chunk == 0)
+				active--;
+			if (active > 0)
+				MPI_Irecv(recvVec.data(), recvCount.count(), recvCount.type(), MPI_ANY_SOURCE, TAG_RESULT,
+						  MPI_COMM_WORLD, &recvRequest);
+			endPhase(opts, PHASE_REDISTRIBUTE, t);
+		}
+		t = MPI_Wtime();
+		traceWaitall(opts, worldSize, sendRequests.data(), MPI_STATUSES_IGNORE);
+		endPhase(opts, PHASE_REDISTRIBUTE, t);
+
+		printVector(opts, "Final Master vector", resultVec);
+	}
+	else
+	{
+		long long count = 0;
+		while (true)
+		{
+			//! Returning the previous chunk's results doubles as the request for the next chunk
+			t = MPI_Wtime();
+			traceSend(opts, slaveVec.data(), count, MPI_DOUBLE, MASTER, TAG_RESULT, MPI_COMM_WORLD);
+			t = endPhase(opts, PHASE_RESULTS, t);
+
+			MPI_Status status;
+			slaveVec.resize(static_cast<size_t>(maxChunk));
+			traceRecv(opts, slaveVec.data(), maxChunk, MPI_DOUBLE, MASTER, TAG_WORK, MPI_COMM_WORLD, &status);
+			count = receivedCount(&status, maxChunk, MPI_DOUBLE);
+			endPhase(opts, PHASE_REDISTRIBUTE, t);
+			if (count == 0)
+				break;
+
+			slaveVec.resize(static_cast<size_t>(count));
+			computeSine(opts, worldRank, slaveVec);
+		}
+	}
+	recordHeld(opts, (opts.stats != nullptr) ? opts.stats->computed : 0);
+	writeResults(opts, 0, resultVec);
+	late.finish(opts);
+}
+
+//! Queue word of a rank's bounds (see TAIL_BIAS)
+inline uint64_t packQueue(const int64_t head, const int64_t tail)
+{
+	return (static_cast<uint64_t>(tail + TAIL_BIAS) << 32) | static_cast<uint64_t>(head);
+}
+
+inline int64_t queueHead(const uint64_t queue)
+{
+	return static_cast<int64_t>(queue & 0xffffffffULL);
+}
+
+inline int64_t queueTail(const uint64_t queue)
+{
+	return static_cast<int64_t>(queue >> 32) - TAIL_BIAS;
+}
+
+//! Take angles from a rank's queue, either a chunk from the head (owner) or half from the tail (thief).
+//! Returns false if nothing could be taken; otherwise [begin, end) now belongs to the caller.
+bool claimRange(MPI_Win queueWin, const int target, const bool owner, const Options& opts, const int worldSize,
+				int64_t& begin, int64_t& end)
+{
+	uint64_t queue, update;
+	MPI_Fetch_and_op(nullptr, &queue, MPI_UINT64_T, target, 0, MPI_NO_OP, queueWin);
+	MPI_Win_flush(target, queueWin);
+
+	//! Size the request from a snapshot; a thief leaves a lone last angle to its owner
+	int64_t remaining = queueTail(queue) - queueHead(queue), take;
+	if (owner)
+	{
+		if (remaining <= 0)
+			return false;
+		take = nextChunk(opts, remaining, worldSize);
+		update = static_cast<uint64_t>(take);
+	}
+	else
+	{
+		if (remaining < 2)
+			return false;
+		take = remaining / 2;
+		update = 0 - (static_cast<uint64_t>(take) << 32);
+	}
+
+	MPI_Fetch_and_op(&update, &queue, MPI_UINT64_T, target, 0, MPI_SUM, queueWin);
+	MPI_Win_flush(target, queueWin);
+
+	//! Keep only the part of the request that the other end had not already taken
+	int64_t head = queueHead(queue), tail = queueTail(queue);
+	if (owner)
+	{
+		begin = head;
+		end = std::min(head + take, tail);
+	}
+	else
+	{
+		begin = std::max(tail - take, head);
+		end = tail;
+	}
+
+	return end > begin;
+}
+
+//! Balance without any master involvement: every rank exposes its own angles in an MPI window, works through
+//! them from the head, and once empty steals half of the remaining range of random victims from the tail.
+//! Results are written back into the owner's result window, so they end up in the original order.
+void stealBalance(const Options& opts, const int worldSize, const int worldRank)
+{
+	ArenaVector<double> slaveVec, resultVec, stolenVec, masterVec;
+
+	loadAngles(opts, worldSize, worldRank, slaveVec);
+
+	//! Expose angles, results and the packed head/tail of this rank's queue in MPI-allocated windows, which
+	//! lets the MPI library pick its fastest one-sided transport
+	double t = MPI_Wtime();
+	MPI_Win angleWin, resultWin, queueWin;
+	double *angles, *results;
+	uint64_t *queue;
+	MPI_Aint bytes = static_cast<MPI_Aint>(slaveVec.size() * sizeof(double));
+	MPI_Win_allocate(bytes, sizeof(double), MPI_INFO_NULL, MPI_COMM_WORLD, &angles, &angleWin);
+	MPI_Win_allocate(bytes, sizeof(double), MPI_INFO_NULL, MPI_COMM_WORLD, &results, &resultWin);
+	MPI_Win_allocate(sizeof(uint64_t), sizeof(uint64_t), MPI_INFO_NULL, MPI_COMM_WORLD, &queue, &queueWin);
+	std::copy(slaveVec.begin(), slaveVec.end(), angles);
+	*queue = packQueue(0, static_cast<int64_t>(slaveVec.size()));
+	MPI_Barrier(MPI_COMM_WORLD);
+	MPI_Win_lock_all(MPI_MODE_NOCHECK, angleWin);
+	MPI_Win_lock_all(MPI_MODE_NOCHECK, resultWin);
+	MPI_Win_lock_all(MPI_MODE_NOCHECK, queueWin);
+	endPhase(opts, PHASE_REDISTRIBUTE, t);
+
+	int64_t begin, end;
+	Xoshiro256 rng(opts.seed, worldRank, STREAM_STEAL);
+	if ((worldRank != MASTER) || opts.masterComputes)
+	{
+		//! Work through own angles (in place; the local angles are never written remotely)
+		t = MPI_Wtime();
+		while (claimRange(queueWin, worldRank, true, opts, worldSize, begin, end))
+		{
+			stolenVec.assign(angles + begin, angles + end);
+			endPhase(opts, PHASE_REDISTRIBUTE, t);
+			computeSine(opts, worldRank, stolenVec);
+			std::copy(stolenVec.begin(), stolenVec.end(), results + begin);
+			t = MPI_Wtime();
+		}
+		MPI_Win_sync(resultWin);
+		endPhase(opts, PHASE_REDISTRIBUTE, t);
+
+		//! Steal from random victims; once a sweep over every rank finds nothing to steal, all work is claimed
+		while (true)
+		{
+			t = MPI_Wtime();
+			int victim = -1;
+			for (int attempt = 0; (attempt < worldSize) && (victim < 0); attempt++)
+			{
+				int r = static_cast<int>(rng.uniformInt(0, worldSize - 1));
+				if ((r != worldRank) && claimRange(queueWin, r, false, opts, worldSize, begin, end))
+					victim = r;
+			}
+			for (int r = 0; (r < worldSize) && (victim < 0); r++)
+				if ((r != worldRank) && claimRange(queueWin, r, false, opts, worldSize, begin, end))
+					victim = r;
+			if (victim < 0)
+			{
+				endPhase(opts, PHASE_REDISTRIBUTE, t);
+				break;
+			}
+
+			//! Fetch the stolen angles, compute them and put the results back at the victim
+			int count = static_cast<int>(end - begin);
+			stolenVec.resize(static_cast<size_t>(count));
+			MPI_Get(stolenVec.data(), count, MPI_DOUBLE, victim, static_cast<MPI_Aint>(begin), count, MPI_DOUBLE,
+					angleWin);
+			MPI_Win_flush(victim, angleWin);
+			countBytes(opts, 0, typeBytes(count, MPI_DOUBLE));
+			endPhase(opts, PHASE_REDISTRIBUTE, t);
+			computeSine(opts, worldRank, stolenVec);
+			t = MPI_Wtime();
+			MPI_Put(stolenVec.data(), count, MPI_DOUBLE, victim, static_cast<MPI_Aint>(begin), count, MPI_DOUBLE,
+					resultWin);
+			MPI_Win_flush(victim, resultWin);
+			countBytes(opts, typeBytes(count, MPI_DOUBLE), 0);
+			endPhase(opts, PHASE_RESULTS, t);
+		}
+	}
+
+	t = MPI_Wtime();
+	MPI_Win_unlock_all(queueWin);
+	MPI_Win_unlock_all(resultWin);
+	MPI_Win_unlock_all(angleWin);
+
+	//! Every rank's remote results have landed once everyone has closed their epochs
+	double wait = MPI_Wtime();
+	MPI_Barrier(MPI_COMM_WORLD);
+	endWait(opts, wait);
+	recordHeld(opts, (opts.stats != nullptr) ? opts.stats->computed : 0);
+	resultVec.assign(results, results + slaveVec.size());
+	MPI_Win_free(&queueWin);
+	MPI_Win_free(&resultWin);
+	MPI_Win_free(&angleWin);
+	endPhase(opts, PHASE_RESULTS, t);
+
+	//! The angles never pass through the master, so collect them only to print them
+	if (opts.verbosity >= VERBOSITY_DEBUG)
+	{
+		gatherToMaster(opts, PHASE_COUNTS, PHASE_GATHER, worldSize, worldRank, slaveVec, masterVec);
+		if (worldRank == MASTER)
+			printVector(opts, "Master vector", masterVec);
+	}
+
+	//! Results are back in their owners' input order, so with an output file every rank writes its own; they stay
+	//! where they are otherwise, and the master only collects them to print them
+	if (opts.output != MPI_FILE_NULL)
+	{
+		long long held = static_cast<long long>(resultVec.size()), heldOffset = 0;
+		MPI_Exscan(&held, &heldOffset, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+		writeResults(opts, (worldRank == MASTER) ? 0 : heldOffset, resultVec);
+	}
+
+	if (opts.verbosity >= VERBOSITY_DEBUG)
+	{
+		gatherToMaster(opts, PHASE_RESULTS, PHASE_RESULTS, worldSize, worldRank, resultVec, masterVec);
+		if (worldRank == MASTER)
+			printVector(opts, "Final Master vector", masterVec);
+	}
+}
+
+//! Balance like the collective mode, but move every balanced slice in chunks of non-blocking messages so a
+//! worker computes chunk i while chunk i+1 arrives and chunk i-1 travels back
+void pipelineBalance(const Options& opts, const int worldSize, const int worldRank)
+{
+	long long balancedSize = 0;
+	ArenaVector<double> masterVec, slaveVec, resultVec;
+	std::vector<long long> balanced, balancedDispls;
+
+	loadAngles(opts, worldSize, worldRank, slaveVec);
+	gatherToMaster(opts, PHASE_COUNTS, PHASE_GATHER, worldSize, worldRank, slaveVec, masterVec);
+
+	if (worldRank == MASTER)
+	{
+		printVector(opts, "Master vector", masterVec);
+
+		ArenaVector<double> weights;
+		if (opts.balance == Balance::WEIGHTED)
+			weights = angleWeights(opts, masterVec);
+		balanced = masterPartition(opts, masterVec, weights, initialCapacity(opts, worldSize));
+		balancedDispls = displacements(balanced);
+	}
+	double t = MPI_Wtime();
+	MPI_Scatter(balanced.data(), 1, MPI_LONG_LONG, &balancedSize, 1, MPI_LONG_LONG, MASTER, MPI_COMM_WORLD);
+	endPhase(opts, PHASE_COUNTS, t);
+	recordHeld(opts, balancedSize);
+
+	long long chunk = opts.pipelineChunk;
+	if (worldRank == MASTER)
+	{
+		//! Stream every worker's slice out in chunks and post the matching result receives straight into place
+		resultVec.resize(opts.keepResults ? static_cast<size_t>(balancedSize) : masterVec.size());
+		std::vector<MPI_Request> requests;
+		t = MPI_Wtime();
+		for (int r = 1; r < worldSize; r++)
+		{
+			for (long long begin = 0; begin < balanced[r]; begin += chunk)
+			{
+				long long count = std::min(chunk, balanced[r] - begin);
+				long long offset = balancedDispls[r] + begin;
+				requests.push_back(MPI_REQUEST_NULL);
+				traceIsend(opts, masterVec.data() + offset, count, MPI_DOUBLE, r, TAG_WORK, MPI_COMM_WORLD,
+						   &requests.back());
+				if (opts.keepResults)
+					continue;
+				requests.push_back(MPI_REQUEST_NULL);
+				traceIrecv(opts, resultVec.data() + offset, count, MPI_DOUBLE, r, TAG_RESULT, MPI_COMM_WORLD,
+						   &requests.back());
+			}
+		}
+		endPhase(opts, PHASE_REDISTRIBUTE, t);
+
+		//! Master's own slice is computed while the transfers progress
+		if (balancedSize > 0)
+		{
+			runKernel(opts, masterVec.data(), resultVec.data(), static_cast<size_t>(balancedSize));
+			reportSines(opts, worldRank, masterVec.data(), resultVec.data(), static_cast<size_t>(balancedSize));
+		}
+		t = MPI_Wtime();
+		traceWaitall(opts, static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+		endPhase(opts, PHASE_RESULTS, t);
+
+		if (!opts.keepResults)
+			printVector(opts, "Final Master vector", resultVec);
+	}
+	else
+	{
+		int numChunks = static_cast<int>((balancedSize + chunk - 1) / chunk);
+		slaveVec.resize(static_cast<size_t>(balancedSize));
+		resultVec.resize(static_cast<size_t>(balancedSize));
+		std::vector<MPI_Request> recvRequests(static_cast<size_t>(numChunks), MPI_REQUEST_NULL);
+		std::vector<MPI_Request> sendRequests(static_cast<size_t>(numChunks), MPI_REQUEST_NULL);
+
+		//! Keep PIPELINE_DEPTH chunks arriving ahead of the one being computed
+		t = MPI_Wtime();
+		for (int c = 0; (c < PIPELINE_DEPTH) && (c < numChunks); c++)
+			traceIrecv(opts, slaveVec.data() + c * chunk, std::min(chunk, balancedSize - c * chunk), MPI_DOUBLE,
+					   MASTER, TAG_WORK, MPI_COMM_WORLD, &recvRequests[c]);
+		endPhase(opts, PHASE_REDISTRIBUTE, t);
+
+		for (int c = 0; c < numChunks; c++)
+		{
+			long long begin = c * chunk;
+			long long count = std::min(chunk, balancedSize - begin);
+			t = MPI_Wtime();
+			traceWait(opts, &recvRequests[c], MPI_STATUS_IGNORE);
+
+			int ahead = c + PIPELINE_DEPTH;
+			if (ahead < numChunks)
+				traceIrecv(opts, slaveVec.data() + ahead * chunk, std::min(chunk, balancedSize - ahead * chunk),
+						   MPI_DOUBLE, MASTER, TAG_WORK, MPI_COMM_WORLD, &recvRequests[ahead]);
+			endPhase(opts, PHASE_REDISTRIBUTE, t);
+
+			runKernel(opts, slaveVec.data() + begin, resultVec.data() + begin, static_cast<size_t>(count));
+			if (!opts.keepResults)
+			{
+				t = MPI_Wtime();
+				traceIsend(opts, resultVec.data() + begin, count, MPI_DOUBLE, MASTER, TAG_RESULT, MPI_COMM_WORLD,
+						   &sendRequests[c]);
+				endPhase(opts, PHASE_RESULTS, t);
+			}
+			reportSines(opts, worldRank, slaveVec.data() + begin, resultVec.data() + begin, static_cast<size_t>(count));
+		}
+		t = MPI_Wtime();
+		traceWaitall(opts, numChunks, sendRequests.data(), MPI_STATUSES_IGNORE);
+		endPhase(opts, PHASE_RESULTS, t);
+		if (!opts.keepResults)
+			resultVec.clear();
+	}
+
+	//! Kept results are the slices as scattered, which lie in rank order
+	if (opts.keepResults)
+	{
+		long long offset = 0;
+		MPI_Exscan(&balancedSize, &offset, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+		finishResults(opts, worldRank, resultVec, (worldRank == MASTER) ? 0 : offset);
+		return;
+	}
+	writeResults(opts, 0, resultVec);
+}
+
+const char *modeName(const Mode mode)
+{
+	switch (mode)
+	{
+		case Mode::SERIAL:
+			return "serial";
+		case Mode::COLLECTIVE:
+			return "collective";
+		case Mode::DECENTRALIZED:
+			return "decentralized";
+		case Mode::DYNAMIC:
+			return "dynamic";
+		case Mode::STEAL:
+			return "steal";
+		case Mode::PIPELINE:
+			return "pipeline";
+		case Mode::STREAM:
+			return "stream";
+		case Mode::HIERARCHICAL:
+			return "hierarchical";
+		case Mode::DIFFUSION:
+			return "diffusion";
+	}
+
+	return "unknown";
+}
+
+const char *wireName(const Wire wire)
+{
+	switch (wire)
+	{
+		case Wire::DOUBLE:
+			return "double";
+		case Wire::FLOAT:
+			return "float";
+		case Wire::FIXED16:
+			return "fixed16";
+	}
+
+	return "unknown";
+}
+
+//! Min, max and sum of a per-rank value on the master, over the ranks that are counted
+template< typename T >
+void reduceSpread(const T value, const bool counted, const MPI_Datatype type, T& min, T& max, T& sum)
+{
+	T minIn = counted ? value : std::numeric_limits<T>::max();
+	T maxIn = counted ? value : std::numeric_limits<T>::lowest();
+	T sumIn = counted ? value : T();
+	MPI_Reduce(&minIn, &min, 1, type, MPI_MIN, MASTER, MPI_COMM_WORLD);
+	MPI_Reduce(&maxIn, &max, 1, type, MPI_MAX, MASTER, MPI_COMM_WORLD);
+	MPI_Reduce(&sumIn, &sum, 1, type, MPI_SUM, MASTER, MPI_COMM_WORLD);
+}
+
+void reportSummary(const Options& opts, const int worldSize, const int worldRank, const RankStats& stats,
+				   const double elapsed)
+{
+	//! A master that does not compute is left out of the per-rank work statistics, but not of the
+	//! communication statistics
+	bool worker = (worldRank != MASTER) || opts.masterComputes;
+	int workers = std::max(1, opts.masterComputes ? worldSize : worldSize - 1);
+
+	long long minBefore = 0, maxBefore = 0, sumBefore = 0, minAfter = 0, maxAfter = 0, sumAfter = 0;
+	long long minComputed = 0, maxComputed = 0, total = 0, minBytes = 0, maxBytes = 0, sumBytes = 0;
+	reduceSpread(stats.generated, worker, MPI_LONG_LONG, minBefore, maxBefore, sumBefore);
+	reduceSpread(stats.held, worker, MPI_LONG_LONG, minAfter, maxAfter, sumAfter);
+	reduceSpread(stats.computed, true, MPI_LONG_LONG, minComputed, maxComputed, total);
+	reduceSpread(stats.bytesSent + stats.bytesReceived, true, MPI_LONG_LONG, minBytes, maxBytes, sumBytes);
+
+	double minTime = 0.0, maxTime = 0.0, sumTime = 0.0, minWait = 0.0, maxWait = 0.0, sumWait = 0.0;
+	double maxElapsed = 0.0;
+	reduceSpread(stats.phaseTime[PHASE_COMPUTE], worker, MPI_DOUBLE, minTime, maxTime, sumTime);
+	reduceSpread(stats.waitTime, true, MPI_DOUBLE, minWait, maxWait, sumWait);
+	MPI_Reduce(&elapsed, &maxElapsed, 1, MPI_DOUBLE, MPI_MAX, MASTER, MPI_COMM_WORLD);
+
+	//! Every rank's own metrics, in rank order
+	const int numCounts = 5, numTimes = 2;
+	long long counts[numCounts] = {stats.generated, stats.held, stats.computed, stats.bytesSent,
+								   stats.bytesReceived};
+	double times[numTimes] = {stats.phaseTime[PHASE_COMPUTE], stats.waitTime};
+	std::vector<long long> rankCounts;
+	ArenaVector<double> rankTimes;
+	if (opts.rankStats)
+	{
+		if (worldRank == MASTER)
+		{
+			rankCounts.resize(static_cast<size_t>(worldSize * numCounts));
+			rankTimes.resize(static_cast<size_t>(worldSize * numTimes));
+		}
+		MPI_Gather(counts, numCounts, MPI_LONG_LONG, rankCounts.data(), numCounts, MPI_LONG_LONG, MASTER,
+				   MPI_COMM_WORLD);
+		MPI_Gather(times, numTimes, MPI_DOUBLE, rankTimes.data(), numTimes, MPI_DOUBLE, MASTER, MPI_COMM_WORLD);
+	}
+
+	if ((worldRank != MASTER) || (opts.verbosity < VERBOSITY_SUMMARY))
+		return;
+
+	double meanBefore = static_cast<double>(sumBefore) / workers, meanAfter = static_cast<double>(sumAfter) / workers;
+	std::ostringstream out;
+	out << "Mode = " << modeName(opts.mode);
+	if (strcmp(strategyName(opts), modeName(opts.mode)) != 0)
+		out << " (" << strategyName(opts) << ")";
+	out << ", wire = " << wireName(opts.wire) << ", ranks = " << worldSize
+		<< ", threads per rank = " << opts.threads << ", seed = " << opts.seed << "\n"
+		<< "Angles computed = " << total << "\n"
+		<< "Angles per rank before = min " << minBefore << ", max " << maxBefore << ", mean " << meanBefore << "\n"
+		<< "Angles per rank after = min " << minAfter << ", max " << maxAfter << ", mean " << meanAfter << "\n"
+		<< "Imbalance (max/mean) = before " << ((meanBefore > 0.0) ? maxBefore / meanBefore : 1.0)
+		<< ", after " << ((meanAfter > 0.0) ? maxAfter / meanAfter : 1.0) << "\n"
+		<< "Compute time per rank (s) = min " << minTime << ", max " << maxTime
+		<< ", mean " << sumTime / workers << "\n"
+		<< "Wait time per rank (s) = min " << minWait << ", max " << maxWait
+		<< ", mean " << sumWait / worldSize << "\n"
+		<< "Bytes moved per rank = min " << minBytes << ", max " << maxBytes
+		<< ", mean " << static_cast<double>(sumBytes) / worldSize << "\n"
+		<< "Total time (s) = " << maxElapsed << "\n";
+
+	if (opts.rankStats)
+		for (int r = 0; r < worldSize; r++)
+		{
+			const long long *c = rankCounts.data() + r * numCounts;
+			const double *t = rankTimes.data() + r * numTimes;
+			out << "Rank " << r << ": before " << c[0] << ", after " << c[1] << ", computed " << c[2]
+				<< ", compute (s) " << t[0] << ", wait (s) " << t[1] << ", sent " << c[3] << " B, received "
+				<< c[4] << " B\n";
+		}
+	std::cout << out.str() << std::flush;
+}
+
+std::vector<StrategyInfo>& strategies()
+{
+	static std::vector<StrategyInfo> registry = {
+		{"serial", Mode::SERIAL, serialBalance, false, Balance::COUNT},
+		{"collective", Mode::COLLECTIVE, collectiveBalance, false, Balance::COUNT},
+		{"decentralized", Mode::DECENTRALIZED, decentralizedBalance, false, Balance::COUNT},
+		{"dynamic", Mode::DYNAMIC, dynamicBalance, false, Balance::COUNT},
+		{"steal", Mode::STEAL, stealBalance, false, Balance::COUNT},
+		{"pipeline", Mode::PIPELINE, pipelineBalance, false, Balance::COUNT},
+		{"stream", Mode::STREAM, streamBalance, false, Balance::COUNT},
+		{"hierarchical", Mode::HIERARCHICAL, hierarchicalBalance, false, Balance::COUNT},
+		{"diffusion", Mode::DIFFUSION, diffusionBalance, false, Balance::COUNT},
+		{"static-even", Mode::COLLECTIVE, collectiveBalance, true, Balance::COUNT},
+		{"weighted", Mode::COLLECTIVE, collectiveBalance, true, Balance::WEIGHTED},
+		{"dynamic-queue", Mode::DYNAMIC, dynamicBalance, false, Balance::COUNT},
+		{"work-stealing", Mode::STEAL, stealBalance, false, Balance::COUNT}
+	};
+
+	return registry;
+}
+
+void registerStrategy(const StrategyInfo& info)
+{
+	std::vector<StrategyInfo>& registry = strategies();
+	for (size_t i = 0; i < registry.size(); i++)
+		if (registry[i].name == info.name)
+		{
+			registry[i] = info;
+			return;
+		}
+	registry.push_back(info);
+}
+
+const StrategyInfo *findStrategy(const std::string& name)
+{
+	const std::vector<StrategyInfo>& registry = strategies();
+	for (size_t i = 0; i < registry.size(); i++)
+		if (registry[i].name == name)
+			return &registry[i];
+
+	return nullptr;
+}
+
+void applyStrategy(const StrategyInfo& info, Options& opts)
+{
+	opts.mode = info.mode;
+	opts.strategy = info.run;
+	opts.strategyName = info.name;
+	if (info.presetBalance)
+		opts.balance = info.balance;
+}
+
+const char *strategyName(const Options& opts)
+{
+	return opts.strategyName.empty() ? modeName(opts.mode) : opts.strategyName.c_str();
+}
+
+void runMode(const Options& opts, const int worldSize, const int worldRank)
+{
+	Strategy run = opts.strategy;
+	if (run == nullptr)
+		run = findStrategy(modeName(opts.mode))->run;
+	run(opts, worldSize, worldRank);
+}
+
+const char *scalingName(const Scaling scaling)
+{
+	switch (scaling)
+	{
+		case Scaling::RANDOM:
+			return "random";
+		case Scaling::STRONG:
+			return "strong";
+		case Scaling::WEAK:
+			return "weak";
+	}
+
+	return "unknown";
+}
+
+void runBenchmark(Options opts, const int worldSize, const int worldRank)
+{
+	const int numTimes = NUM_PHASES + 2;
+	std::ostringstream out;
+	if (worldRank == MASTER)
+	{
+		if (opts.json)
+			out << "{\"mode\": \"" << strategyName(opts) << "\", \"ranks\": " << worldSize
+				<< ", \"threads\": " << opts.threads << ", \"scaling\": \"" << scalingName(opts.scaling)
+				<< "\", \"seed\": " << opts.seed << ", \"runs\": [";
+		else if (opts.benchOutput.empty() || !std::ifstream(opts.benchOutput.c_str()).good())
+			out << "mode,ranks,threads,scaling,size,repetition,phase,min,max,mean\n";
+	}
+
+	for (int rep = -opts.warmup; rep < opts.repeat; rep++)
+	{
+		//! Let a PMPI profiler skip the warm-up passes
+		MPI_Pcontrol((rep < 0) ? 0 : 1);
+
+		RankStats stats;
+		opts.stats = &stats;
+		MPI_Barrier(MPI_COMM_WORLD);
+		double start = MPI_Wtime();
+		runMode(opts, worldSize, worldRank);
+
+		//! Phase times followed by the time of the whole pass and the time blocked in communication
+		double times[numTimes];
+		std::copy(stats.phaseTime, stats.phaseTime + NUM_PHASES, times);
+		times[NUM_PHASES] = MPI_Wtime() - start;
+		times[NUM_PHASES + 1] = stats.waitTime;
+		if (rep < 0)
+			continue;
+
+		double minTimes[numTimes], maxTimes[numTimes], sumTimes[numTimes];
+		long long size = 0;
+		MPI_Reduce(times, minTimes, numTimes, MPI_DOUBLE, MPI_MIN, MASTER, MPI_COMM_WORLD);
+		MPI_Reduce(times, maxTimes, numTimes, MPI_DOUBLE, MPI_MAX, MASTER, MPI_COMM_WORLD);
+		MPI_Reduce(times, sumTimes, numTimes, MPI_DOUBLE, MPI_SUM, MASTER, MPI_COMM_WORLD);
+		MPI_Reduce(&stats.generated, &size, 1, MPI_LONG_LONG, MPI_SUM, MASTER, MPI_COMM_WORLD);
+		if (worldRank != MASTER)
+			continue;
+
+		if (opts.json)
+			out << ((rep > 0) ? ", " : "") << "{\"repetition\": " << rep << ", \"size\": " << size
+				<< ", \"phases\": {";
+		for (int p = 0; p < numTimes; p++)
+		{
+			const char *phase = (p < NUM_PHASES) ? PHASE_NAMES[p] : ((p == NUM_PHASES) ? "total" : "wait");
+			double mean = sumTimes[p] / worldSize;
+			if (opts.json)
+				out << ((p > 0) ? ", " : "") << "\"" << phase << "\": {\"min\": " << minTimes[p]
+					<< ", \"max\": " << maxTimes[p] << ", \"mean\": " << mean << "}";
+			else
+				out << strategyName(opts) << "," << worldSize << "," << opts.threads << ","
+					<< scalingName(opts.scaling) << "," << size << "," << rep << "," << phase << ","
+					<< minTimes[p] << "," << maxTimes[p] << "," << mean << "\n";
+		}
+		if (opts.json)
+			out << "}}";
+	}
+
+	if (worldRank != MASTER)
+		return;
+
+	//! One JSON object per run and line (JSON Lines), so runs appended to one file stay readable line by line
+	if (opts.json)
+		out << "]}\n";
+	if (opts.benchOutput.empty())
+		std::cout << out.str() << std::flush;
+	else
+	{
+		std::ofstream file(opts.benchOutput.c_str(), std::ios::app);
+		if (!file)
+			std::cerr << "Cannot open benchmark output: " << opts.benchOutput << std::endl;
+		file << out.str();
+	}
+}
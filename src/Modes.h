@@ -0,0 +1,92 @@
+/**
+* @file This file is part of LoadBalance.
+*
+* @section LICENSE
+* MIT License
+*
+* Copyright (c) 2018 Rajdeep Konwar
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*
+* @section DESCRIPTION
+* Redistribution schemes, their summary and the benchmark driver
+**/
+
+#ifndef LOADBALANCE_MODES_H
+#define LOADBALANCE_MODES_H
+
+#include "Data.h"
+
+//! Work-stealing queue bounds packed into one word, so a single MPI_Fetch_and_op updates either end atomically
+//! with respect to the other: the owner takes chunks from the head (low half), thieves take from the tail
+//! (high half). The tail is biased so thieves overshooting an already empty queue cannot wrap it around.
+const int64_t TAIL_BIAS = 1LL << 31;
+
+//! Name of a redistribution scheme as given on the command line
+const char *modeName(const Mode mode);
+
+//! Name of a wire format as given on the command line
+const char *wireName(const Wire wire);
+
+//! Reduce every rank's work to summary statistics printed by the master, followed by every rank's own metrics
+//! if asked for
+void reportSummary(const Options& opts, const int worldSize, const int worldRank, const RankStats& stats,
+				   const double elapsed);
+
+//! Redistribution scheme selectable by name at run time. It runs under the option rules and statistics of its
+//! mode; an alias can also preset the partitioning criterion of that mode.
+struct StrategyInfo
+{
+	std::string name;		//!< Name given to --strategy or --mode
+	Mode mode;				//!< Scheme whose option rules apply
+	Strategy run;			//!< Entry point
+	bool presetBalance;		//!< Whether the strategy sets the partitioning criterion
+	Balance balance;		//!< Partitioning criterion if preset
+};
+
+//! Every selectable strategy: the built-in modes under their own names, then the aliases static-even
+//! (collective, count), weighted (collective, weighted), dynamic-queue (dynamic) and work-stealing (steal),
+//! then those added with registerStrategy
+std::vector<StrategyInfo>& strategies();
+
+//! Add a strategy, replacing one of the same name
+void registerStrategy(const StrategyInfo& info);
+
+//! Strategy of the given name, or nullptr if there is none
+const StrategyInfo *findStrategy(const std::string& name);
+
+//! Select a strategy for a run
+void applyStrategy(const StrategyInfo& info, Options& opts);
+
+//! Name of the selected strategy, which is the mode's unless it was selected by an alias
+const char *strategyName(const Options& opts);
+
+//! Run one pass of the selected strategy
+void runMode(const Options& opts, const int worldSize, const int worldRank);
+
+//! Name of an input size configuration as given on the command line
+const char *scalingName(const Scaling scaling);
+
+//! Repeat the selected mode after untimed warm-up passes and write each pass's phase times, reduced across all
+//! ranks to min/max/mean, as CSV rows or a JSON document. An output file is appended to, so a sweep over rank
+//! counts or modes collects into one table.
+void runBenchmark(Options opts, const int worldSize, const int worldRank);
+
+#endif
@@ -0,0 +1,214 @@
+/**
+* @file This file is part of LoadBalance.
+*
+* @section LICENSE
+* MIT License
+*
+* Copyright (c) 2018 Rajdeep Konwar
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*
+* @section DESCRIPTION
+* Partitioning of angles across ranks and the decentralized balancing engine
+**/
+
+#include "Partition.h"
+
+#include <cstring>
+#include <numeric>
+
+std::vector<long long> balancedCounts(const long long total, const int worldSize, const bool masterComputes)
+{
+	std::vector<long long> counts(static_cast<size_t>(worldSize), 0);
+
+	//! Master is always rank 0, so workers are either all ranks or ranks 1 to N-1
+	int first = masterComputes ? 0 : 1;
+	int workers = worldSize - first;
+	if (workers < 1)
+		return counts;
+
+	long long balancedSize = total / workers;
+	long long remainder = total % workers;
+	for (int i = first; i < worldSize; i++)
+		counts[i] = balancedSize + ((i - first < remainder) ? 1 : 0);
+
+	return counts;
+}
+
+std::vector<long long> proportionalCounts(const long long total, const ArenaVector<double>& capacity)
+{
+	std::vector<long long> counts(capacity.size(), 0);
+	double totalCapacity = std::accumulate(capacity.begin(), capacity.end(), 0.0);
+	if (totalCapacity <= 0.0)
+		return counts;
+
+	double cumulative = 0.0;
+	long long previous = 0;
+	for (size_t r = 0; r < capacity.size(); r++)
+	{
+		cumulative += capacity[r];
+		long long bound = (r + 1 == capacity.size()) ? total
+						  : std::llround(static_cast<double>(total) * cumulative / totalCapacity);
+		counts[r] = bound - previous;
+		previous = bound;
+	}
+
+	return counts;
+}
+
+ArenaVector<double> initialCapacity(const Options& opts, const int worldSize)
+{
+	ArenaVector<double> capacity(static_cast<size_t>(worldSize), 1.0);
+	if (!opts.rankWeights.empty())
+		capacity.assign(opts.rankWeights.begin(), opts.rankWeights.end());
+	if (!opts.masterComputes)
+		capacity[MASTER] = 0.0;
+
+	return capacity;
+}
+
+std::vector<long long> weightedCounts(const ArenaVector<double>& weights, const double weightOffset,
+									  const double totalWeight, const ArenaVector<double>& capacity)
+{
+	std::vector<long long> counts(capacity.size(), 0);
+
+	double totalCapacity = 0.0;
+	size_t last = 0;
+	for (size_t r = 0; r < capacity.size(); r++)
+	{
+		totalCapacity += capacity[r];
+		if (capacity[r] > 0.0)
+			last = r;
+	}
+	if (totalCapacity <= 0.0)
+		return counts;
+
+	//! Upper weight boundary of each rank
+	ArenaVector<double> bounds(capacity.size());
+	double cumulative = 0.0;
+	for (size_t r = 0; r < capacity.size(); r++)
+	{
+		cumulative += capacity[r];
+		bounds[r] = totalWeight * cumulative / totalCapacity;
+	}
+
+	size_t r = 0;
+	double prefix = weightOffset;
+	for (size_t i = 0; i < weights.size(); i++)
+	{
+		double mid = prefix + 0.5 * weights[i];
+		while ((r < last) && (mid >= bounds[r]))
+			r++;
+		counts[r]++;
+		prefix += weights[i];
+	}
+
+	return counts;
+}
+
+void updateCapacity(const ArenaVector<double>& assigned, const ArenaVector<double>& elapsed,
+					ArenaVector<double>& capacity)
+{
+	ArenaVector<double> throughput(capacity.size(), 0.0);
+	double sum = 0.0;
+	int measured = 0;
+	for (size_t r = 0; r < capacity.size(); r++)
+	{
+		if ((capacity[r] > 0.0) && (assigned[r] > 0.0) && (elapsed[r] > 0.0))
+		{
+			throughput[r] = assigned[r] / elapsed[r];
+			sum += throughput[r];
+			measured++;
+		}
+	}
+	if (measured == 0)
+		return;
+
+	double mean = sum / measured;
+	for (size_t r = 0; r < capacity.size(); r++)
+		if (throughput[r] > 0.0)
+			capacity[r] = throughput[r] / mean;
+}
+
+ArenaVector<double> angleWeights(const Options& opts, const ArenaVector<double>& angles)
+{
+	ArenaVector<double> weights(angles.size());
+	for (size_t i = 0; i < angles.size(); i++)
+		weights[i] = opts.cost(angles[i]);
+
+	return weights;
+}
+
+void dedupeValues(const ArenaVector<double>& values, ArenaVector<double>& distinct, std::vector<long long>& index)
+{
+	ArenaVector<uint64_t> bits(values.size());
+	std::memcpy(bits.data(), values.data(), values.size() * sizeof(double));
+	ArenaVector<uint64_t> keys(bits);
+	std::sort(keys.begin(), keys.end());
+	keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+	index.resize(values.size());
+	for (size_t i = 0; i < bits.size(); i++)
+		index[i] = std::lower_bound(keys.begin(), keys.end(), bits[i]) - keys.begin();
+	distinct.resize(keys.size());
+	std::memcpy(distinct.data(), keys.data(), keys.size() * sizeof(double));
+}
+
+std::vector<long long> masterPartition(const Options& opts, const ArenaVector<double>& angles,
+									   const ArenaVector<double>& weights, const ArenaVector<double>& capacity)
+{
+	if (opts.balance == Balance::WEIGHTED)
+	{
+		double totalWeight = 0.0;
+		for (size_t i = 0; i < weights.size(); i++)
+			totalWeight += weights[i];
+		return weightedCounts(weights, 0.0, totalWeight, capacity);
+	}
+
+	if (!opts.rankWeights.empty() || opts.feedback)
+		return proportionalCounts(static_cast<long long>(angles.size()), capacity);
+	return balancedCounts(static_cast<long long>(angles.size()), static_cast<int>(capacity.size()),
+						  opts.masterComputes);
+}
+
+std::vector<long long> displacements(const std::vector<long long>& counts)
+{
+	std::vector<long long> displs(counts.size(), 0);
+	for (size_t i = 1; i < counts.size(); i++)
+		displs[i] = displs[i - 1] + counts[i - 1];
+
+	return displs;
+}
+
+std::vector<long long> overlapCounts(const long long offset, const long long count,
+									 const std::vector<long long>& balanced,
+									 const std::vector<long long>& balancedDispls)
+{
+	std::vector<long long> overlap(balanced.size(), 0);
+	for (size_t i = 0; i < balanced.size(); i++)
+	{
+		long long begin = std::max(offset, balancedDispls[i]);
+		long long end = std::min(offset + count, balancedDispls[i] + balanced[i]);
+		if (end > begin)
+			overlap[i] = end - begin;
+	}
+
+	return overlap;
+}
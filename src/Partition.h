@@ -0,0 +1,247 @@
+/**
+* @file This file is part of LoadBalance.
+*
+* @section LICENSE
+* MIT License
+*
+* Copyright (c) 2018 Rajdeep Konwar
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*
+* @section DESCRIPTION
+* Partitioning of angles across ranks and the decentralized balancing engine
+**/
+
+#ifndef LOADBALANCE_PARTITION_H
+#define LOADBALANCE_PARTITION_H
+
+#include "Comm.h"
+
+//! Number of angles assigned to each rank; the first (total % workers) workers take one extra each
+std::vector<long long> balancedCounts(const long long total, const int worldSize, const bool masterComputes);
+
+//! Split total consecutive elements so each rank's count is proportional to its capacity
+std::vector<long long> proportionalCounts(const long long total, const ArenaVector<double>& capacity);
+
+//! Relative compute capacity of each rank, its throughput weight; the master has none unless it computes
+ArenaVector<double> initialCapacity(const Options& opts, const int worldSize);
+
+//! Split consecutive elements of the given weights, starting at weightOffset in a global weight space of
+//! totalWeight, so each rank's share of the weight is proportional to its capacity. An element belongs to
+//! the rank whose weight interval contains the element's midpoint, which keeps every share contiguous.
+std::vector<long long> weightedCounts(const ArenaVector<double>& weights, const double weightOffset,
+									  const double totalWeight, const ArenaVector<double>& capacity);
+
+//! Rescale capacities to each rank's measured throughput (weight per second) relative to the mean;
+//! ranks that did no measurable work keep their previous capacity
+void updateCapacity(const ArenaVector<double>& assigned, const ArenaVector<double>& elapsed,
+					ArenaVector<double>& capacity);
+
+//! Estimated cost of every angle
+ArenaVector<double> angleWeights(const Options& opts, const ArenaVector<double>& angles);
+
+//! Distinct values in ascending order of their bit patterns, and for every value the index of its copy among
+//! them. Bits rather than == decide what is identical, so -0.0 and NaNs stay apart and results are exact.
+void dedupeValues(const ArenaVector<double>& values, ArenaVector<double>& distinct, std::vector<long long>& index);
+
+//! Number of angles assigned to each rank by the master, which holds all of them
+std::vector<long long> masterPartition(const Options& opts, const ArenaVector<double>& angles,
+									   const ArenaVector<double>& weights, const ArenaVector<double>& capacity);
+
+//! Exclusive prefix sum of counts
+std::vector<long long> displacements(const std::vector<long long>& counts);
+
+//! Number of angles in [offset, offset + count) that fall in each rank's balanced range
+std::vector<long long> overlapCounts(const long long offset, const long long count,
+									 const std::vector<long long>& balanced,
+									 const std::vector<long long>& balancedDispls);
+
+//! Collect every rank's vector on the master in rank order with MPI_Gather/MPI_Gatherv, charging the count
+//! exchange and the data transfer to the given phases
+template <typename T>
+void gatherToMaster(const Options& opts, const Phase countPhase, const Phase dataPhase, const int worldSize,
+					const int worldRank, const ArenaVector<T>& slaveVec, ArenaVector<T>& masterVec)
+{
+	long long numAngles = static_cast<long long>(slaveVec.size());
+	std::vector<long long> counts, displs;
+
+	//! Gather number of elements from every rank
+	double t = MPI_Wtime();
+	if (worldRank == MASTER)
+		counts.resize(static_cast<size_t>(worldSize));
+	MPI_Gather(&numAngles, 1, MPI_LONG_LONG, counts.data(), 1, MPI_LONG_LONG, MASTER, MPI_COMM_WORLD);
+
+	//! Gather all elements directly into their offsets in the master vector
+	if (worldRank == MASTER)
+	{
+		displs = displacements(counts);
+		masterVec.resize(static_cast<size_t>(displs.back() + counts.back()));
+	}
+	t = endPhase(opts, countPhase, t);
+	traceGatherv(opts, slaveVec.data(), numAngles, MpiType<T>::get(),
+				 masterVec.data(), counts.data(), displs.data(), MpiType<T>::get(), MASTER, MPI_COMM_WORLD);
+	endPhase(opts, dataPhase, t);
+}
+
+//! Decentralized balancing engine for elements of any type T with an MpiType and a batch kernel turning them
+//! into results of type R. Elements are contiguous in global order across the ranks. Each rank ships the parts
+//! of its elements that other ranks own with one MPI_Alltoallv, runs the kernel over what it receives (split
+//! across its compute threads) and keeps the results, or collects them on the master. The built-in
+//! decentralized and stream modes drive it with angles in their wire format and a kernel that decodes them for
+//! the dispatched sine kernel; for example
+//!     auto square = [](const float *in, float *out, size_t n)
+//!     {
+//!         for (size_t i = 0; i < n; i++)
+//!             out[i] = in[i] * in[i];
+//!     };
+//!     LoadBalancer<float, decltype(square)> balancer(opts, square, worldSize, worldRank);
+//!     balancer.run(local, results);
+template <typename T, typename Kernel, typename R = T>
+class LoadBalancer
+{
+public:
+	LoadBalancer(const Options& opts, const Kernel& kernel, const int worldSize, const int worldRank)
+		: m_opts(opts), m_kernel(kernel), m_worldSize(worldSize), m_worldRank(worldRank)
+	{
+	}
+
+	//! Find this rank's offset in the global order and the global number of elements. With one weight per
+	//! local element, later partitions split on the global weight instead of on counts; every rank has to
+	//! pass weights, or nullptr, alike.
+	void locate(const ArenaVector<T>& local, const ArenaVector<double> *weights = nullptr)
+	{
+		double t = MPI_Wtime();
+		m_count = static_cast<long long>(local.size());
+		MPI_Exscan(&m_count, &m_offset, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+		if (m_worldRank == MASTER)
+			m_offset = 0;
+		MPI_Allreduce(&m_count, &m_total, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+
+		m_weighted = weights != nullptr;
+		if (m_weighted)
+		{
+			m_weights = *weights;
+			double localWeight = 0.0;
+			for (size_t i = 0; i < m_weights.size(); i++)
+				localWeight += m_weights[i];
+			MPI_Exscan(&localWeight, &m_weightOffset, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+			if (m_worldRank == MASTER)
+				m_weightOffset = 0.0;
+			MPI_Allreduce(&localWeight, &m_totalWeight, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+		}
+		endPhase(m_opts, PHASE_COUNTS, t);
+	}
+
+	//! Every rank derives the same balanced partition of the global index (or weight) space, scaled by the
+	//! capacities, and works out the ranges overlapping each owner's balanced slice. Returns the size of this
+	//! rank's slice.
+	long long plan(const ArenaVector<double>& capacity)
+	{
+		double t = MPI_Wtime();
+		if (m_weighted)
+			m_sendCounts = weightedCounts(m_weights, m_weightOffset, m_totalWeight, capacity);
+		else
+		{
+			std::vector<long long> counts = (m_opts.rankWeights.empty() && !m_opts.feedback)
+											? balancedCounts(m_total, m_worldSize, m_opts.masterComputes)
+											: proportionalCounts(m_total, capacity);
+			m_sendCounts = overlapCounts(m_offset, m_count, counts, displacements(counts));
+		}
+		m_sendDispls = displacements(m_sendCounts);
+		m_recvCounts.resize(static_cast<size_t>(m_worldSize));
+		MPI_Alltoall(m_sendCounts.data(), 1, MPI_LONG_LONG, m_recvCounts.data(), 1, MPI_LONG_LONG, MPI_COMM_WORLD);
+		m_recvDispls = displacements(m_recvCounts);
+		endPhase(m_opts, PHASE_COUNTS, t);
+
+		long long held = m_recvDispls.back() + m_recvCounts.back();
+		recordHeld(m_opts, held);
+		return held;
+	}
+
+	//! Send only the planned ranges of the local elements to their owners, who receive them in global order. The
+	//! buffers may be device memory if MPI can access it.
+	void exchange(const T *local, T *balanced)
+	{
+		double t = MPI_Wtime();
+		traceAlltoallv(m_opts, local, m_sendCounts.data(), m_sendDispls.data(), MpiType<T>::get(),
+					   balanced, m_recvCounts.data(), m_recvDispls.data(), MpiType<T>::get(), MPI_COMM_WORLD);
+		endPhase(m_opts, PHASE_REDISTRIBUTE, t);
+	}
+
+	//! Plan and exchange into a balanced slice on the host
+	void distribute(const ArenaVector<T>& local, const ArenaVector<double>& capacity, ArenaVector<T>& balanced)
+	{
+		balanced.resize(static_cast<size_t>(plan(capacity)));
+		exchange(local.data(), balanced.data());
+	}
+
+	//! Run the kernel over a balanced slice
+	void compute(const ArenaVector<T>& in, ArenaVector<R>& out) const
+	{
+		out.resize(in.size());
+		runBatch(m_opts, m_kernel, in.data(), out.data(), in.size());
+	}
+
+	//! Send the results of the last distribute back to the ranks the elements came from: the same exchange with
+	//! send and receive counts swapped, so returned holds the result of every local element in its original order
+	template <typename V>
+	void returnToOwners(const V *results, V *returned) const
+	{
+		double t = MPI_Wtime();
+		traceAlltoallv(m_opts, results, m_recvCounts.data(), m_recvDispls.data(), MpiType<V>::get(),
+					   returned, m_sendCounts.data(), m_sendDispls.data(), MpiType<V>::get(), MPI_COMM_WORLD);
+		endPhase(m_opts, PHASE_RESULTS, t);
+	}
+
+	template <typename V>
+	void returnToOwners(const ArenaVector<V>& results, ArenaVector<V>& returned) const
+	{
+		returned.resize(static_cast<size_t>(m_count));
+		returnToOwners(results.data(), returned.data());
+	}
+
+	//! Collect every rank's results in global order on the master
+	void collect(const ArenaVector<R>& results, ArenaVector<R>& all) const
+	{
+		gatherToMaster(m_opts, PHASE_RESULTS, PHASE_RESULTS, m_worldSize, m_worldRank, results, all);
+	}
+
+	//! Count-balance this rank's elements, in proportion to the ranks' --rank-weight if they differ, and compute
+	//! its balanced slice
+	void run(const ArenaVector<T>& local, ArenaVector<R>& results)
+	{
+		ArenaVector<T> balanced;
+		locate(local);
+		distribute(local, initialCapacity(m_opts, m_worldSize), balanced);
+		compute(balanced, results);
+	}
+
+private:
+	const Options& m_opts;
+	Kernel m_kernel;
+	int m_worldSize, m_worldRank;
+	long long m_count = 0, m_offset = 0, m_total = 0;
+	bool m_weighted = false;
+	ArenaVector<double> m_weights;
+	double m_weightOffset = 0.0, m_totalWeight = 0.0;
+	std::vector<long long> m_sendCounts, m_sendDispls, m_recvCounts, m_recvDispls;	//!< Last distribute's exchange
+};
+
+#endif
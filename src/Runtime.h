@@ -0,0 +1,544 @@
+/**
+* @file This file is part of LoadBalance.
+*
+* @section LICENSE
+* MIT License
+*
+* Copyright (c) 2018 Rajdeep Konwar
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+*
+* @section DESCRIPTION
+* Run options, per-rank statistics, compute threads and the buffer arena
+**/
+
+#ifndef LOADBALANCE_RUNTIME_H
+#define LOADBALANCE_RUNTIME_H
+
+#include <mpi.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#include "Kernels.h"
+
+#define MASTER 0
+
+//! Redistribution schemes
+enum class Mode
+{
+	SERIAL,			//!< Master exchanges with each slave in turn using MPI_Send/MPI_Recv
+	COLLECTIVE,		//!< Master redistributes using MPI_Gatherv/MPI_Scatterv
+	DECENTRALIZED,	//!< Ranks exchange overlapping ranges directly with MPI_Alltoallv
+	DYNAMIC,		//!< Workers request chunks from a queue on the master as they finish
+	STEAL,			//!< Idle ranks steal half of a random victim's remaining angles through MPI RMA
+	PIPELINE,		//!< Balanced slices move in chunks with MPI_Isend/MPI_Irecv, overlapping compute
+	STREAM,			//!< The input file is read, rebalanced, computed and written one window at a time
+	HIERARCHICAL,	//!< Balanced within each shared-memory node first; only node surpluses cross the network
+	DIFFUSION		//!< Long-running timesteps; only excess angles diffuse to neighbours, and only when imbalanced
+};
+
+//! Chunk sizing of the dynamic work queue
+enum class Schedule
+{
+	FIXED,	//!< Every chunk has the same size
+	GUIDED	//!< Chunks shrink as the queue drains (factoring: half an even share of what remains)
+};
+
+//! Partitioning criteria
+enum class Balance
+{
+	COUNT,		//!< Every rank gets the same number of angles
+	WEIGHTED	//!< Every rank gets the same estimated cost, scaled by its capacity
+};
+
+//! Format angles and sine values are moved in; compute always runs in double
+enum class Wire
+{
+	DOUBLE,		//!< 64-bit floating point, exact
+	FLOAT,		//!< 32-bit floating point, half the bytes
+	FIXED16		//!< 16-bit fixed point over the generated angle range [0, 360) and the sine range [-1, 1]
+};
+
+//! Where a rank computes its balanced slice
+enum class Backend
+{
+	CPU,		//!< Batch sine kernel on the rank's compute threads
+	GPU			//!< OpenMP offload to the rank's default device (built with LOADBALANCE_GPU)
+};
+
+//! Elements handed out at a time by the dynamic thread schedule
+const size_t THREAD_GRAIN = 1024;
+
+//! Persistent pool of compute threads. The calling thread takes part as thread 0 and is the only one that
+//! ever calls MPI, as MPI_THREAD_FUNNELED requires.
+class ThreadPool
+{
+public:
+	explicit ThreadPool(const int numThreads)
+	{
+		for (int id = 1; id < numThreads; id++)
+			m_threads.emplace_back(&ThreadPool::worker, this, id);
+	}
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+		m_start.notify_all();
+		for (size_t i = 0; i < m_threads.size(); i++)
+			m_threads[i].join();
+	}
+
+	int size() const
+	{
+		return static_cast<int>(m_threads.size()) + 1;
+	}
+
+	//! Run func(begin, end) over [0, n) on all threads. The static schedule gives each thread one contiguous
+	//! block; the dynamic one hands out blocks of THREAD_GRAIN elements from a shared counter.
+	void parallelFor(const size_t n, const bool dynamic, const std::function<void(size_t, size_t)>& func)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_job = &func;
+			m_n = n;
+			m_dynamic = dynamic;
+			m_next = 0;
+			m_pending = static_cast<int>(m_threads.size());
+			m_generation++;
+		}
+		m_start.notify_all();
+
+		run(0);
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_done.wait(lock, [this] { return m_pending == 0; });
+		m_job = nullptr;
+	}
+
+private:
+	void worker(const int id)
+	{
+		int generation = 0;
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_start.wait(lock, [this, generation] { return m_stop || (m_generation != generation); });
+				if (m_stop)
+					return;
+				generation = m_generation;
+			}
+
+			run(id);
+
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_pending--;
+			}
+			m_done.notify_one();
+		}
+	}
+
+	void run(const int id)
+	{
+		if (m_dynamic)
+		{
+			size_t begin;
+			while ((begin = m_next.fetch_add(THREAD_GRAIN)) < m_n)
+				(*m_job)(begin, std::min(begin + THREAD_GRAIN, m_n));
+		}
+		else
+		{
+			size_t threads = static_cast<size_t>(size());
+			size_t begin = m_n * static_cast<size_t>(id) / threads;
+			size_t end = m_n * static_cast<size_t>(id + 1) / threads;
+			if (end > begin)
+				(*m_job)(begin, end);
+		}
+	}
+
+	std::vector<std::thread> m_threads;
+	std::mutex m_mutex;
+	std::condition_variable m_start, m_done;
+	const std::function<void(size_t, size_t)> *m_job = nullptr;
+	size_t m_n = 0;
+	bool m_dynamic = false;
+	std::atomic<size_t> m_next{0};
+	int m_pending = 0, m_generation = 0;
+	bool m_stop = false;
+};
+
+//! Alignment and smallest size of an arena block: one page, so no two buffers share a page or a cache line
+const size_t ARENA_PAGE = 4096;
+
+//! Transparent huge page size; with huge pages, blocks at least this large are aligned to it
+const size_t HUGE_PAGE = 2 << 20;
+
+//! Largest power-of-two size class; bigger blocks are sized to a multiple of their alignment instead
+const size_t ARENA_LARGE = 1 << 19;
+
+//! Freed blocks above ARENA_LARGE kept for reuse; further ones go back to MPI
+const size_t ARENA_LARGE_CACHE = 16;
+
+//! Process-wide pool of the buffers holding angles, sine values and their wire formats. Blocks come from
+//! MPI_Alloc_mem, so the MPI library can hand out memory registered for RDMA, and freed blocks are cached.
+//! Buffers that are cleared, rebuilt and resized every phase and iteration thus reuse the same blocks after
+//! the first pass, without allocating or faulting pages in again. Blocks up to ARENA_LARGE come in power-of-two
+//! size classes; larger ones are rounded up to whole pages (huge pages with --huge-pages) only, so the large
+//! angle and sine buffers take at most a page or two more than asked, and a freed one serves any later request
+//! it exceeds by at most an eighth; up to ARENA_LARGE_CACHE of them are kept. Placement is by first touch only,
+//! with no explicit NUMA binding: the rank's compute threads first write a new block with the static schedule
+//! of the kernels, so on a first-touch system each thread's part of a buffer lands on its NUMA node. Only the
+//! thread making MPI calls allocates.
+class BufferArena
+{
+public:
+	static BufferArena& instance()
+	{
+		static BufferArena arena;
+		return arena;
+	}
+
+	//! Threads placing new blocks, and whether blocks of a huge page or more are backed by huge pages
+	void configure(ThreadPool *pool, const bool hugePages)
+	{
+		m_pool = pool;
+		m_hugePages = hugePages;
+	}
+
+	void *allocate(const size_t bytes)
+	{
+		size_t align = (m_hugePages && (bytes >= HUGE_PAGE)) ? HUGE_PAGE : ARENA_PAGE;
+		size_t size;
+		if (bytes <= ARENA_LARGE)
+		{
+			int sizeClass = classOf(bytes);
+			if (!m_free[sizeClass].empty())
+			{
+				void *block = m_free[sizeClass].back();
+				m_free[sizeClass].pop_back();
+				m_reused++;
+				return block;
+			}
+			size = static_cast<size_t>(1) << sizeClass;
+		}
+		else
+		{
+			size = (bytes + align - 1) / align * align;
+			std::multimap<size_t, void *>::iterator fit = m_large.lower_bound(size);
+			if ((fit != m_large.end()) && (fit->first <= size + size / 8))
+			{
+				void *block = fit->second;
+				m_large.erase(fit);
+				m_reused++;
+				return block;
+			}
+		}
+
+		void *raw;
+		MPI_Alloc_mem(static_cast<MPI_Aint>(size + align), MPI_INFO_NULL, &raw);
+		char *block = reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(raw) + align - 1) & ~(align - 1));
+		m_blocks[block] = Block{raw, size};
+#if defined(MADV_HUGEPAGE)
+		if (align == HUGE_PAGE)
+			madvise(block, size, MADV_HUGEPAGE);
+#endif
+		firstTouch(block, size);
+		m_allocated++;
+		return block;
+	}
+
+	void deallocate(void *block, const size_t)
+	{
+		//! Block sizes fall on the same side of ARENA_LARGE as the requests they were made for
+		std::unordered_map<void *, Block>::iterator it = m_blocks.find(block);
+		size_t size = it->second.size;
+		if (size <= ARENA_LARGE)
+			m_free[classOf(size)].push_back(block);
+		else if (m_large.size() < ARENA_LARGE_CACHE)
+			m_large.insert(std::make_pair(size, block));
+		else
+		{
+			MPI_Free_mem(it->second.raw);
+			m_blocks.erase(it);
+		}
+	}
+
+	//! Hand every block back to MPI. Called before MPI_Finalize, once no buffer is alive.
+	void release()
+	{
+		for (std::unordered_map<void *, Block>::iterator it = m_blocks.begin(); it != m_blocks.end(); ++it)
+			MPI_Free_mem(it->second.raw);
+		m_blocks.clear();
+		for (int c = 0; c < NUM_CLASSES; c++)
+			m_free[c].clear();
+		m_large.clear();
+		m_pool = nullptr;
+	}
+
+	//! Blocks obtained from MPI, and allocations served from the cache instead
+	long long allocated() const
+	{
+		return m_allocated;
+	}
+
+	long long reused() const
+	{
+		return m_reused;
+	}
+
+private:
+	static const int NUM_CLASSES = 64;
+
+	static int classOf(const size_t bytes)
+	{
+		int sizeClass = 12;
+		while ((static_cast<size_t>(1) << sizeClass) < bytes)
+			sizeClass++;
+		return sizeClass;
+	}
+
+	//! With one thread the rank's own first write already places the pages on its node
+	void firstTouch(char *block, const size_t size)
+	{
+		if ((m_pool == nullptr) || (m_pool->size() == 1))
+			return;
+
+		m_pool->parallelFor(size / ARENA_PAGE, false, [block](size_t begin, size_t end)
+		{
+			for (size_t page = begin; page < end; page++)
+				block[page * ARENA_PAGE] = 0;
+		});
+	}
+
+	ThreadPool *m_pool = nullptr;
+	bool m_hugePages = false;
+	//! A block as handed out, with the pointer MPI_Alloc_mem returned and its usable size
+	struct Block
+	{
+		void *raw;
+		size_t size;
+	};
+
+	std::vector<void *> m_free[NUM_CLASSES];	//!< Cached blocks up to ARENA_LARGE by size class
+	std::multimap<size_t, void *> m_large;		//!< Cached larger blocks by size
+	std::unordered_map<void *, Block> m_blocks;
+	long long m_allocated = 0, m_reused = 0;
+};
+
+//! Standard allocator drawing from the buffer arena
+template <typename T>
+struct ArenaAllocator
+{
+	typedef T value_type;
+
+	ArenaAllocator() = default;
+
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U>&)
+	{
+	}
+
+	T *allocate(const size_t n)
+	{
+		return static_cast<T *>(BufferArena::instance().allocate(n * sizeof(T)));
+	}
+
+	void deallocate(T *p, const size_t n)
+	{
+		BufferArena::instance().deallocate(p, n * sizeof(T));
+	}
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>&, const ArenaAllocator<U>&)
+{
+	return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>&, const ArenaAllocator<U>&)
+{
+	return false;
+}
+
+//! Vector of angles, sine values or their wire formats
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+//! Output levels
+const int VERBOSITY_QUIET = 0;		//!< Errors only
+const int VERBOSITY_SUMMARY = 1;	//!< Summary statistics on the master
+const int VERBOSITY_DEBUG = 2;		//!< Every angle and sine value as well
+
+//! Phases of a run timed separately on every rank
+enum Phase
+{
+	PHASE_COUNTS,		//!< Exchanging element counts and offsets
+	PHASE_GATHER,		//!< Collecting the generated angles
+	PHASE_REDISTRIBUTE,	//!< Moving angles to the ranks that compute them
+	PHASE_COMPUTE,		//!< Running the sine kernel
+	PHASE_RESULTS,		//!< Returning or collecting sine values
+	PHASE_IO,			//!< Reading angles from and writing sine values to files
+	NUM_PHASES
+};
+
+const char *const PHASE_NAMES[NUM_PHASES] = {"counts", "gather", "redistribute", "compute", "results", "io"};
+
+//! Work done by a rank
+struct RankStats
+{
+	long long generated = 0;			//!< Angles generated, i.e. held before rebalancing
+	long long held = 0;					//!< Angles held after (the last) rebalancing
+	long long computed = 0;				//!< Angles computed
+	long long bytesSent = 0;			//!< Bytes sent to other ranks
+	long long bytesReceived = 0;		//!< Bytes received from other ranks
+	double waitTime = 0.0;				//!< Seconds blocked in receives, sends and waits
+	double phaseTime[NUM_PHASES] = {};	//!< Seconds spent in each phase
+};
+
+//! Input sizes for scaling studies
+enum class Scaling
+{
+	RANDOM,	//!< --count-min to --count-max (1 to 50) angles per generating rank
+	STRONG,	//!< A fixed global number of angles spread over the generating ranks
+	WEAK	//!< A fixed mean number of angles per generating rank
+};
+
+//! How a strong or weak scaling input is spread over the generating ranks
+enum class Distribution
+{
+	UNIFORM,	//!< Equal shares
+	ZIPF,		//!< The k-th generating rank's share falls off as 1/k^s
+	HEAVY		//!< A few leading ranks carry a multiple of everyone else's share
+};
+
+struct Options;
+
+//! Redistribution scheme: balances one pass over the angles across the ranks and computes their sine values
+typedef void (*Strategy)(const Options&, int, int);
+
+//! Run-time options
+struct Options
+{
+	Mode mode = Mode::SERIAL;				//!< Redistribution scheme whose option rules and statistics apply
+	Strategy strategy = nullptr;			//!< Entry point of the scheme (nullptr: the built-in one of mode)
+	std::string strategyName;				//!< Name the strategy was selected by (empty: that of mode)
+	bool masterComputes = false;			//!< Give the master its own share of the angles
+	Balance balance = Balance::COUNT;		//!< Partitioning criterion
+	Wire wire = Wire::DOUBLE;				//!< Format of the angles and sine values on the wire
+	CostModel cost = rangeReductionCost;	//!< Per-angle cost estimate for weighted balancing
+	int iterations = 1;						//!< Number of redistribute/compute passes over the same angles
+	bool feedback = false;					//!< Rescale rank capacities by measured compute throughput
+	Schedule schedule = Schedule::GUIDED;	//!< Chunk sizing of the dynamic queue
+	int chunk = 1;							//!< Fixed chunk size, or the minimum guided chunk size
+	SineKernel kernel = nullptr;			//!< Batch sine kernel; chosen by CPU dispatch unless overridden
+	double lutError = LUT_ERROR;			//!< Largest error of the lookup-table kernel
+	bool dedupe = false;					//!< Ship and compute every distinct angle only once
+	int threads = 1;						//!< Compute threads per rank (0: one per hardware thread)
+	bool dynamicThreads = false;			//!< Dynamic instead of static schedule across compute threads
+	ThreadPool *pool = nullptr;				//!< Compute threads of this rank
+	bool hugePages = false;					//!< Back large buffers with transparent huge pages
+	Backend backend = Backend::CPU;			//!< Where this rank computes
+	double rankWeight = 1.0;				//!< Relative throughput of this rank, e.g. larger on GPU ranks
+	std::vector<double> rankWeights;		//!< Every rank's throughput weight; empty while they are all equal
+	int pipelineChunk = 1024;				//!< Angles per message in the pipelined mode
+	int nodeSize = 0;						//!< Ranks per node of the hierarchical mode (0: whole shared-memory nodes)
+	double threshold = 1.05;				//!< Imbalance (max/mean) above which the diffusion mode rebalances
+	double drift = 0.0;						//!< Largest relative change of a rank's angles per diffusion timestep
+	int verbosity = VERBOSITY_SUMMARY;		//!< Amount of output
+	RankStats *stats = nullptr;				//!< Work done by this rank, for the summary
+	Scaling scaling = Scaling::RANDOM;		//!< How the number of generated angles is chosen
+	long long size = 0;						//!< Global (strong) or per-rank (weak) number of angles
+	bool bench = false;						//!< Repeat the run and report phase timings instead of a summary
+	int warmup = 1;							//!< Untimed benchmark repetitions
+	int repeat = 5;							//!< Timed benchmark repetitions
+	bool json = false;						//!< Benchmark output as JSON Lines instead of CSV
+	std::string benchOutput;				//!< Benchmark output file (empty: standard output)
+	bool rankStats = false;					//!< Print every rank's metrics after the summary
+	Distribution distribution = Distribution::UNIFORM;	//!< Spread of a scaling input over the ranks
+	double zipfExponent = 1.0;				//!< Exponent s of the Zipf distribution
+	int heavyRanks = 1;						//!< Number of heavy ranks
+	double heavyFactor = 10.0;				//!< Share of a heavy rank relative to the others
+	uint64_t seed = 0;						//!< Seed of every random stream; the same seed gives the same input
+	long long countMin = 1;					//!< Fewest angles of a generating rank with random scaling
+	long long countMax = 50;				//!< Most angles of a generating rank with random scaling
+	double angleMin = 0.0;					//!< Lower bound of the generated angles
+	double angleMax = 360.0;				//!< Upper bound of the generated angles
+	MPI_File input = MPI_FILE_NULL;			//!< Flat binary array of angles read instead of generated
+	long long inputSize = 0;				//!< Number of angles in the input file
+	MPI_File output = MPI_FILE_NULL;		//!< Flat binary array the sine values are written to
+	bool returnResults = false;				//!< Send the sine values back to the ranks the angles came from
+	bool keepResults = false;				//!< Leave the sine values on the ranks that computed them
+	long long window = 1 << 20;				//!< Angles per window of the streaming mode
+	double timeout = 0.0;					//!< Seconds before a dynamic chunk is handed to another rank (0: never)
+	bool speculate = false;					//!< Duplicate the slowest outstanding dynamic chunks on idle ranks
+	std::string checkpoint;					//!< File of completed dynamic ranges to resume from (empty: none)
+};
+
+//! Run a batch kernel over n contiguous elements, split across the rank's compute threads. The kernel is any
+//! callable taking (const T *in, R *out, size_t n). It is called once per block with its type known at compile
+//! time, so a functor or lambda is inlined into the caller rather than dispatched per element.
+template <typename T, typename R, typename Kernel>
+void runBatch(const Options& opts, const Kernel& kernel, const T *in, R *out, const size_t n)
+{
+	double start = MPI_Wtime();
+	if ((opts.pool == nullptr) || (opts.pool->size() == 1) || (n < THREAD_GRAIN))
+		kernel(in, out, n);
+	else
+	{
+		opts.pool->parallelFor(n, opts.dynamicThreads, [&kernel, in, out](size_t begin, size_t end)
+		{
+			kernel(in + begin, out + begin, end - begin);
+		});
+	}
+
+	if (opts.stats != nullptr)
+	{
+		opts.stats->computed += static_cast<long long>(n);
+		opts.stats->phaseTime[PHASE_COMPUTE] += MPI_Wtime() - start;
+	}
+}
+
+//! Run the batch sine kernel over n contiguous angles
+void runKernel(const Options& opts, const double *in, double *out, const size_t n);
+
+//! Charge the time since start to one phase of this rank's stats; returns the current time so that
+//! consecutive phases can be chained
+double endPhase(const Options& opts, const Phase phase, const double start);
+
+#endif
@@ -0,0 +1,172 @@
+/**
+* @file This file is part of LoadBalance.
+*
+* @section LICENSE
+* MIT License
+*
+* Copyright (c) 2018 Rajdeep Konwar
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*
+* @section DESCRIPTION
+* Test helper: writes the input angles of the MPI tests and checks their sine values against std::sin or
+* against the output of another run
+**/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//! Largest magnitude of the generated angles, so range reduction is exercised beyond one period
+#define CHECK_MAX_ANGLE	1.0e4
+
+//! Read a flat binary array of doubles
+bool readDoubles(const std::string& path, std::vector<double>& values)
+{
+	std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+	if (!file)
+		return false;
+
+	std::streamoff bytes = file.tellg();
+	if (bytes % static_cast<std::streamoff>(sizeof(double)) != 0)
+		return false;
+	values.resize(static_cast<size_t>(bytes) / sizeof(double));
+	file.seekg(0);
+	return static_cast<bool>(file.read(reinterpret_cast<char *>(values.data()), bytes));
+}
+
+//! Write n angles in [-CHECK_MAX_ANGLE, CHECK_MAX_ANGLE] from a fixed 64-bit LCG, so every build tests the
+//! same input. With distinct > 0, the angles repeat distinct values in random order.
+int generate(const std::string& path, const long long n, const long long distinct)
+{
+	std::vector<double> angles(static_cast<size_t>(n));
+	uint64_t state = 0x9e3779b97f4a7c15ULL;
+	for (size_t i = 0; i < angles.size(); i++)
+	{
+		state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+		double unit = static_cast<double>(state >> 11) * (1.0 / 9007199254740992.0);
+		if (distinct > 0)
+			unit = std::floor(unit * static_cast<double>(distinct)) / static_cast<double>(distinct);
+		angles[i] = (2.0 * unit - 1.0) * CHECK_MAX_ANGLE;
+	}
+
+	std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+	if (!file.write(reinterpret_cast<const char *>(angles.data()),
+					static_cast<std::streamsize>(angles.size() * sizeof(double))))
+	{
+		std::cerr << "Cannot write " << path << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+//! Check that sines holds the sine of every angle, in order, within tolerance
+int compare(const std::string& anglePath, const std::string& sinePath, const double tolerance)
+{
+	std::vector<double> angles, sines;
+	if (!readDoubles(anglePath, angles) || !readDoubles(sinePath, sines))
+	{
+		std::cerr << "Cannot read " << anglePath << " and " << sinePath << " as arrays of doubles" << std::endl;
+		return EXIT_FAILURE;
+	}
+	if (angles.size() != sines.size())
+	{
+		std::cerr << sinePath << " holds " << sines.size() << " values for " << angles.size() << " angles"
+				  << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	size_t wrong = 0, first = 0;
+	double worst = 0.0;
+	for (size_t i = 0; i < angles.size(); i++)
+	{
+		double error = std::fabs(sines[i] - std::sin(angles[i]));
+		if (!(error <= tolerance))
+		{
+			if (wrong++ == 0)
+				first = i;
+		}
+		if (error > worst)
+			worst = error;
+	}
+
+	if (wrong > 0)
+	{
+		std::cerr << wrong << " of " << angles.size() << " sine values are off by more than " << tolerance
+				  << ", the first at index " << first << " (sin(" << angles[first] << ") = " << sines[first]
+				  << ")" << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::cout << angles.size() << " sine values within " << worst << " of std::sin" << std::endl;
+
+	return EXIT_SUCCESS;
+}
+
+//! Check that output holds the same values as reference, in order, within tolerance
+int match(const std::string& referencePath, const std::string& outputPath, const double tolerance)
+{
+	std::vector<double> reference, output;
+	if (!readDoubles(referencePath, reference) || !readDoubles(outputPath, output))
+	{
+		std::cerr << "Cannot read " << referencePath << " and " << outputPath << " as arrays of doubles" << std::endl;
+		return EXIT_FAILURE;
+	}
+	if (reference.size() != output.size())
+	{
+		std::cerr << outputPath << " holds " << output.size() << " values, " << referencePath << " "
+				  << reference.size() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	double worst = 0.0;
+	for (size_t i = 0; i < reference.size(); i++)
+	{
+		double error = std::fabs(output[i] - reference[i]);
+		if (!(error <= tolerance))
+		{
+			std::cerr << "Value " << i << " is " << output[i] << " instead of " << reference[i] << std::endl;
+			return EXIT_FAILURE;
+		}
+		worst = std::max(worst, error);
+	}
+	std::cout << output.size() << " values within " << worst << " of the reference" << std::endl;
+
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+	std::string command((argc > 1) ? argv[1] : "");
+	if ((command == "generate") && ((argc == 4) || (argc == 5)))
+		return generate(argv[2], std::max(0LL, atoll(argv[3])), (argc == 5) ? atoll(argv[4]) : 0);
+	if ((command == "compare") && ((argc == 4) || (argc == 5)))
+		return compare(argv[2], argv[3], (argc == 5) ? atof(argv[4]) : 1.0e-12);
+	if ((command == "match") && ((argc == 4) || (argc == 5)))
+		return match(argv[2], argv[3], (argc == 5) ? atof(argv[4]) : 1.0e-12);
+
+	std::cerr << "Usage: " << argv[0] << " generate ANGLES N [DISTINCT] | compare ANGLES SINES [TOLERANCE]"
+			  << " | match REFERENCE OUTPUT [TOLERANCE]" << std::endl;
+	return EXIT_FAILURE;
+}